@@ -0,0 +1,12 @@
+#!/bin/bash
+
+./GPT-2-bench \
+    --benches attention,feedforward,block,gpt2,loss,sample,dataloader \
+    --batch_size 1 8 \
+    --sequence 64 256 \
+    --emb_dim 256 512 \
+    --threads 1 4 \
+    --warmup 3 \
+    --repeat 10 \
+    --output_dir bench_result \
+    --gpu_id -1
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+DATA='the-verdict'
+
+for K in 0 1 2 4 8; do
+    echo "checkpoint_every=${K}"
+    /usr/bin/time -f "max RSS: %M KB, wall: %e s" ./GPT-2 \
+        --train true \
+        --epochs 1 \
+        --dataset ${DATA} \
+        --tokenizer "dist/tokenizer.json" \
+        --vocab_size 50277 \
+        --endoftext 0 \
+        --padding 1 \
+        --batch_size 8 \
+        --checkpoint_every ${K} \
+        --gpu_id -1 2>&1 | grep -E "useful tokens|max RSS"
+done
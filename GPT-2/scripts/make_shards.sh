@@ -0,0 +1,12 @@
+#!/bin/bash
+
+DATA='the-verdict'
+
+./GPT-2 \
+    --make_shards true \
+    --dataset ${DATA} \
+    --tokenizer "dist/tokenizer.json" \
+    --vocab_size 50277 \
+    --endoftext 0 \
+    --padding 1 \
+    --load_workers 8
@@ -0,0 +1,10 @@
+#!/bin/bash
+
+DATA='the-verdict'
+
+./GPT-2 \
+    --optim_bench true \
+    --dataset ${DATA} \
+    --vocab_size 50277 \
+    --optim_bench_steps 50 \
+    --gpu_id -1
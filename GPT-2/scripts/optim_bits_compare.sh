@@ -0,0 +1,27 @@
+#!/bin/bash
+
+DATA='the-verdict'
+EPOCHS=50
+
+GRAPH="checkpoints/${DATA}/graph/data"
+
+for BITS in 32 8; do
+    rm -f ${GRAPH}/train_loss.dat
+    ./GPT-2 \
+        --train true \
+        --epochs ${EPOCHS} \
+        --save_epoch ${EPOCHS} \
+        --dataset ${DATA} \
+        --tokenizer "dist/tokenizer.json" \
+        --vocab_size 50277 \
+        --endoftext 0 \
+        --padding 1 \
+        --batch_size 8 \
+        --optim adamw_fused \
+        --optim_bits ${BITS} \
+        --gpu_id 0
+    cp ${GRAPH}/train_loss.dat ${GRAPH}/train_loss_${BITS}bit.dat
+    du -h checkpoints/${DATA}/optims/epoch_latest.pth
+done
+echo "epoch / ce (32 bit) / epoch / ce (8 bit)"
+paste ${GRAPH}/train_loss_32bit.dat ${GRAPH}/train_loss_8bit.dat
@@ -0,0 +1,33 @@
+#!/bin/bash
+# End-to-end performance check of train, test and predict with a tiny model on synthetic data (offline, CPU).
+# Results in perf_result/<mode>.json are compared with perf_baseline/<mode>.json (tolerances: scripts/perf_compare.sh).
+# The first run, or UPDATE_BASELINE=1, stores the results as the baseline.
+
+DATA='perf-synthetic'
+WORDS=500
+RESULT='perf_result'
+BASELINE='perf_baseline'
+COMMON="--dataset ${DATA} --tokenizer datasets/${DATA}/tokenizer.json --vocab_size $((WORDS + 3)) --endoftext 0 --padding 1 --sequence 64 --stride 16 --emb_dim 64 --n_heads 4 --n_layers 2 --load_workers 0 --gpu_id -1 --seed 0"
+
+# (1) Data and a Fresh Checkpoint Directory
+sh scripts/perf_data.sh ${DATA} ${WORDS} || exit 1
+rm -rf checkpoints/${DATA}
+mkdir -p ${RESULT}
+
+# (2) Runs
+./GPT-2 --train true --epochs 1 --batch_size 8 --save_epoch 1 --render_graph false ${COMMON} --perf_json ${RESULT}/train.json > ${RESULT}/train.log 2>&1 || { echo "train failed : ${RESULT}/train.log"; exit 1; }
+./GPT-2 --test true --test_batch_size 8 ${COMMON} --perf_json ${RESULT}/test.json > ${RESULT}/test.log 2>&1 || { echo "test failed : ${RESULT}/test.log"; exit 1; }
+./GPT-2 --predict true --predict_token 64 ${COMMON} --perf_json ${RESULT}/predict.json > ${RESULT}/predict.log 2>&1 || { echo "predict failed : ${RESULT}/predict.log"; exit 1; }
+
+# (3) Comparison with the Baseline
+status=0
+for mode in train test predict; do
+    if [ "${UPDATE_BASELINE:-0}" = "1" ] || [ ! -f ${BASELINE}/${mode}.json ]; then
+        mkdir -p ${BASELINE}
+        cp ${RESULT}/${mode}.json ${BASELINE}/${mode}.json
+        echo "baseline stored : ${BASELINE}/${mode}.json"
+    else
+        sh scripts/perf_compare.sh ${BASELINE}/${mode}.json ${RESULT}/${mode}.json || status=1
+    fi
+done
+exit ${status}
@@ -0,0 +1,37 @@
+#!/bin/bash
+# Compares a result of 'scripts/perf.sh' with its baseline, and exits with 1 on regressions.
+# usage: sh scripts/perf_compare.sh <baseline.json> <result.json>
+# TOL_RATE    : allowed drop of steps/s and tokens/s (ratio)
+# TOL_RSS     : allowed growth of the peak RSS (ratio)
+# TOL_STARTUP : allowed growth of the startup time (ratio, beyond 0.1 sec)
+
+TOL_RATE=${TOL_RATE:-0.15}
+TOL_RSS=${TOL_RSS:-0.15}
+TOL_STARTUP=${TOL_STARTUP:-0.30}
+
+awk -v tol_rate=${TOL_RATE} -v tol_rss=${TOL_RSS} -v tol_startup=${TOL_STARTUP} -v name="$2" '
+    function kv(line){
+        gsub(/[",{}]/, "", line);
+        if (split(line, a, ":") < 2) return 0;
+        K = a[1];  gsub(/ /, "", K);
+        V = a[2] + 0.0;
+        return 1;
+    }
+    FNR == NR { if (kv($0)){ base[K] = V; keys[n++] = K; } next; }
+    { if (kv($0)) cur[K] = V; }
+    END{
+        fail = 0;
+        printf "%s\n%-28s %14s %14s %9s\n", name, "metric", "baseline", "current", "change";
+        for (i = 0; i < n; i++){
+            k = keys[i];
+            if (!(k in cur)){ printf "%-28s %14.3f %14s %9s  MISSING\n", k, base[k], "-", "-"; fail = 1; continue; }
+            b = base[k];  c = cur[k];
+            status = "";
+            if ((k ~ /_per_s$/) && (c < b * (1.0 - tol_rate))) status = "REGRESSION";
+            if ((k == "peak_rss_mb") && (c > b * (1.0 + tol_rss))) status = "REGRESSION";
+            if ((k == "startup_sec") && (c > b * (1.0 + tol_startup)) && (c - b > 0.1)) status = "REGRESSION";
+            if (status != "") fail = 1;
+            printf "%-28s %14.3f %14.3f %8.1f%%  %s\n", k, b, c, (b != 0.0) ? (c - b) / b * 100.0 : 0.0, status;
+        }
+        exit fail;
+    }' "$1" "$2"
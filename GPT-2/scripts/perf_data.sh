@@ -0,0 +1,37 @@
+#!/bin/bash
+# Synthetic dataset and word-level tokenizer for 'scripts/perf.sh' (offline, deterministic).
+# usage: sh scripts/perf_data.sh <dataset> <words>
+
+DATA=${1:-'perf-synthetic'}
+WORDS=${2:-500}
+ROOT="datasets/${DATA}"
+
+# (1) Tokenizer : <|endoftext|>=0, <|padding|>=1, <|unk|>=2, w0...w<WORDS-1>
+mkdir -p ${ROOT}
+awk -v n=${WORDS} 'BEGIN{
+    printf "{\n  \"version\": \"1.0\",\n  \"truncation\": null,\n  \"padding\": null,\n  \"added_tokens\": [\n";
+    split("<|endoftext|> <|padding|> <|unk|>", special, " ");
+    for (i = 1; i <= 3; i++){
+        printf "    {\"id\": %d, \"content\": \"%s\", \"single_word\": false, \"lstrip\": false, \"rstrip\": false, \"normalized\": false, \"special\": true}%s\n", i - 1, special[i], (i < 3) ? "," : "";
+    }
+    printf "  ],\n  \"normalizer\": null,\n  \"pre_tokenizer\": {\"type\": \"Whitespace\"},\n  \"post_processor\": null,\n  \"decoder\": null,\n";
+    printf "  \"model\": {\"type\": \"WordLevel\", \"unk_token\": \"<|unk|>\", \"vocab\": {\"<|endoftext|>\": 0, \"<|padding|>\": 1, \"<|unk|>\": 2";
+    for (i = 0; i < n; i++) printf ", \"w%d\": %d", i, i + 3;
+    printf "}}\n}\n";
+}' > ${ROOT}/tokenizer.json
+
+# (2) Documents : words drawn with a skew towards small ids, 16 words per line
+make_docs(){
+    mkdir -p ${ROOT}/$1
+    for i in $(seq 1 $2); do
+        awk -v n=${WORDS} -v seed="$3$i" -v count=$4 'BEGIN{
+            srand(seed);
+            for (k = 1; k <= count; k++) printf "w%d%s", int(rand() * rand() * n), (k % 16 == 0) ? "\n" : " ";
+            printf "\n";
+        }' > ${ROOT}/$1/doc_${i}.txt
+    done
+}
+make_docs train 8 1 2000
+make_docs valid 1 2 2000
+make_docs test 2 3 1000
+make_docs predict 1 4 32
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+DATA='the-verdict'
+
+./GPT-2 \
+    --plan true \
+    --dataset ${DATA} \
+    --vocab_size 50277 \
+    --sequence 256 \
+    --batch_size 8 \
+    --plan_memory 16 \
+    --gpu_id 0
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+DATA='the-verdict'
+
+for SCRIPT in checkpoints/${DATA}/graph/data/*.gp; do
+    gnuplot ${SCRIPT}
+done
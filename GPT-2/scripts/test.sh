@@ -9,4 +9,6 @@ DATA='the-verdict'
     --vocab_size 50277 \
     --endoftext 0 \
     --padding 1 \
+    --test_batch_size 8 \
+    --test_workers 4 \
     --gpu_id 0
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+DATA='the-verdict'
+NPROC=${NPROC:-2}
+THREADS=$(( $(nproc) / NPROC ))
+STORE="checkpoints/${DATA}/dist_store"
+
+mkdir -p checkpoints/${DATA}
+rm -f ${STORE}
+
+for RANK in $(seq 0 $(( NPROC - 1 ))); do
+    OMP_NUM_THREADS=$(( THREADS > 0 ? THREADS : 1 )) ./GPT-2 \
+        --train true \
+        --epochs 300 \
+        --dataset ${DATA} \
+        --tokenizer "dist/tokenizer.json" \
+        --vocab_size 50277 \
+        --endoftext 0 \
+        --padding 1 \
+        --batch_size 8 \
+        --gpu_id -1 \
+        --world_size ${NPROC} \
+        --rank ${RANK} \
+        --dist_store ${STORE} &
+done
+wait
@@ -0,0 +1,323 @@
+#include <iostream>                    // std::cout, std::cerr
+#include <fstream>                     // std::ofstream
+#include <filesystem>                  // std::filesystem
+#include <string>                      // std::string
+#include <sstream>                     // std::stringstream
+#include <vector>                      // std::vector
+#include <tuple>                       // std::tuple
+#include <functional>                  // std::function
+#include <algorithm>                   // std::sort, std::find
+#include <chrono>                      // std::chrono
+#include <thread>                      // std::thread
+#include <cmath>                       // std::sqrt
+#include <ios>                         // std::fixed
+#include <iomanip>                     // std::setprecision, std::setw
+// For External Library
+#include <torch/torch.h>               // torch
+#include <boost/program_options.hpp>   // boost::program_options
+#include <boost/any.hpp>               // boost::any
+// For Original Header
+#include "loss.hpp"                    // Loss
+#include "networks.hpp"                // MultiHeadAttention, FeedForward, TransformerBlock, GPT2
+#include "sampling.hpp"                // Sample_TopK
+#include "datasets.hpp"                // datasets::TextFolder
+#include "dataloader.hpp"              // DataLoader::TextFolder
+#include "progress.hpp"                // progress
+
+// Define Namespace
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+
+// Function Prototype
+std::vector<std::string> Split(const std::string &str);
+template <typename T> void Set_Value(po::variables_map &vm, const std::string key, const T value);
+
+
+// -----------------------------------
+// struct{Result}
+// -----------------------------------
+struct Result{
+    std::string bench, mode;
+    size_t batch, sequence, emb_dim, threads;
+    double tokens;  // tokens per repetition
+    std::vector<double> msec;
+    double mean, stddev, min, p50, p90, max;
+};
+
+
+// -----------------------------------
+// 0. Argument Function
+// -----------------------------------
+po::options_description parse_arguments(){
+
+    po::options_description args("Options", 200, 30);
+
+    args.add_options()
+
+        // (1) Define for General Parameter
+        ("help", "produce help message")
+        ("benches", po::value<std::string>()->default_value("attention,feedforward,block,gpt2,loss,sample,dataloader"), "comma separated list of benchmarks")
+        ("output_dir", po::value<std::string>()->default_value("bench_result"), "output directory : ./<output_dir>/bench.{json,csv}")
+        ("gpu_id", po::value<int>()->default_value(-1), "cuda device : 'x=-1' is cpu device")
+        ("seed", po::value<int>()->default_value(0), "seed of random number")
+        ("warmup", po::value<size_t>()->default_value(3), "the number of repetitions excluded from timing")
+        ("repeat", po::value<size_t>()->default_value(10), "the number of repetitions timed")
+
+        // (2) Define for Sweep
+        ("batch_size", po::value<std::vector<size_t>>()->multitoken()->default_value({1, 8}, "1 8"), "batch sizes")
+        ("sequence", po::value<std::vector<size_t>>()->multitoken()->default_value({64, 256}, "64 256"), "sequence lengths")
+        ("emb_dim", po::value<std::vector<size_t>>()->multitoken()->default_value({256, 512}, "256 512"), "embedding feature dimensions")
+        ("threads", po::value<std::vector<size_t>>()->multitoken()->default_value({1, std::max((size_t)1, (size_t)std::thread::hardware_concurrency())}, "1 <cores>"), "intra-op threads of LibTorch (and workers of the data loader)")
+
+        // (3) Define for Network Parameter
+        ("vocab_size", po::value<size_t>()->default_value(8192), "vocabulary size of the synthetic input")
+        ("n_heads", po::value<size_t>()->default_value(8), "the number of heads")
+        ("n_layers", po::value<size_t>()->default_value(2), "the number of layers of 'gpt2'")
+        ("droprate", po::value<float>()->default_value(0.1), "the rate of dropout")
+        ("qkv_bias", po::value<bool>()->default_value(false), "qkv bias")
+        ("temperature", po::value<float>()->default_value(1.0), "sampling temperature of 'sample'")
+        ("topk", po::value<size_t>()->default_value(50), "top-k of 'sample'")
+        ("documents", po::value<size_t>()->default_value(64), "the number of synthetic documents of 'dataloader'")
+        ("document_tokens", po::value<size_t>()->default_value(4096), "the number of tokens per synthetic document of 'dataloader'")
+
+    ;
+
+    // End Processing
+    return args;
+}
+
+
+// -----------------------------------
+// 1. Timing Function
+// -----------------------------------
+// Wall-clock time of each repetition after the warmup (synchronizing CUDA at both ends).
+std::vector<double> Measure(const std::function<void()> &fn, const size_t warmup, const size_t repeat, const torch::Device &device){
+    std::vector<double> msec;
+    std::chrono::steady_clock::time_point start;
+    for (size_t i = 0; i < warmup + repeat; i++){
+        if (device.is_cuda()) torch::cuda::synchronize();
+        start = std::chrono::steady_clock::now();
+        fn();
+        if (device.is_cuda()) torch::cuda::synchronize();
+        if (i >= warmup) msec.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return msec;
+}
+
+
+// -----------------------------------
+// 2. Statistics Function
+// -----------------------------------
+void Summarize(Result &result){
+    std::vector<double> sorted = result.msec;
+    auto percentile = [&](const double p){ return sorted.at((size_t)(p * (double)(sorted.size() - 1) + 0.5)); };
+    std::sort(sorted.begin(), sorted.end());
+    result.mean = 0.0;
+    for (auto &ms : sorted) result.mean += ms;
+    result.mean /= (double)sorted.size();
+    result.stddev = 0.0;
+    for (auto &ms : sorted) result.stddev += (ms - result.mean) * (ms - result.mean);
+    result.stddev = std::sqrt(result.stddev / (double)std::max((size_t)1, sorted.size() - 1));
+    result.min = sorted.front();
+    result.p50 = percentile(0.5);
+    result.p90 = percentile(0.9);
+    result.max = sorted.back();
+    return;
+}
+
+
+// -----------------------------------
+// 3. Main Function
+// -----------------------------------
+int main(int argc, const char *argv[]){
+
+    // (1) Extract Arguments
+    po::options_description args = parse_arguments();
+    po::variables_map vm{};
+    po::store(po::parse_command_line(argc, argv, args), vm);
+    po::notify(vm);
+    if (vm.count("help")){
+        std::cout << args << std::endl;
+        return 1;
+    }
+
+    // (2) Select Device and Set Seed
+    torch::Device device = (torch::cuda::is_available() && (vm["gpu_id"].as<int>() >= 0)) ? torch::Device(torch::kCUDA, vm["gpu_id"].as<int>()) : torch::Device(torch::kCPU);
+    std::cout << "using device = " << device << std::endl;
+    torch::manual_seed(vm["seed"].as<int>());
+
+    // (3) Initialization and Declaration
+    const size_t warmup = vm["warmup"].as<size_t>(), repeat = std::max((size_t)1, vm["repeat"].as<size_t>());
+    const long int V = vm["vocab_size"].as<size_t>(), H = vm["n_heads"].as<size_t>();
+    const float droprate = vm["droprate"].as<float>();
+    const bool qkv_bias = vm["qkv_bias"].as<bool>();
+    std::vector<std::string> benches;
+    std::vector<Result> results;
+    std::string out_dir;
+    std::ofstream ofs;
+
+    benches = Split(vm["benches"].as<std::string>());
+    auto enabled = [&](const std::string name){ return std::find(benches.begin(), benches.end(), name) != benches.end(); };
+    auto run = [&](const std::string bench, const std::string mode, const size_t B, const size_t S, const size_t D, const size_t T, const double tokens, const std::function<void()> &fn){
+        Result result{bench, mode, B, S, D, T, tokens};
+        result.msec = Measure(fn, warmup, repeat, device);
+        Summarize(result);
+        std::cout << std::left << std::setw(12) << bench << std::setw(8) << mode << std::right;
+        std::cout << " batch:" << std::setw(4) << B << " sequence:" << std::setw(5) << S << " emb_dim:" << std::setw(5) << D << " threads:" << std::setw(3) << T;
+        std::cout << std::fixed << std::setprecision(3) << "  mean:" << result.mean << "ms std:" << result.stddev << "ms p50:" << result.p50 << "ms";
+        std::cout << std::setprecision(1) << "  " << tokens / result.mean * 1000.0 << " tokens/s" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        results.push_back(result);
+    };
+
+    // (4) Sweep Threads, Emb_dim, Sequence and Batch Size
+    std::cout << progress::separator_center("Benchmark (" + progress::current_date() + ")") << std::endl;
+    for (auto &T : vm["threads"].as<std::vector<size_t>>()){
+        torch::set_num_threads(T);
+        for (auto &D : vm["emb_dim"].as<std::vector<size_t>>()){
+            if (D % H != 0){
+                std::cerr << "skip emb_dim:" << D << " (not divisible by n_heads:" << H << ")" << std::endl;
+                continue;
+            }
+            for (auto &S : vm["sequence"].as<std::vector<size_t>>()){
+                for (auto &B : vm["batch_size"].as<std::vector<size_t>>()){
+
+                    const double tokens = (double)(B * S);
+                    torch::Tensor x = torch::randn({(long int)B, (long int)S, (long int)D}, torch::TensorOptions().device(device));
+                    torch::Tensor ids = torch::randint(0, V, {(long int)B, (long int)S}, torch::TensorOptions().dtype(torch::kLong).device(device));
+                    torch::Tensor target = torch::randint(0, V, {(long int)B, (long int)S}, torch::TensorOptions().dtype(torch::kLong).device(device));
+
+                    // (4.1) Modules (forward without gradients, and forward with backward)
+                    auto run_module = [&](const std::string bench, nn::Module &module, const std::function<torch::Tensor()> &forward){
+                        module.to(device);
+                        module.eval();
+                        {
+                            torch::NoGradGuard no_grad;
+                            run(bench, "forward", B, S, D, T, tokens, [&](){ forward(); });
+                        }
+                        module.train();
+                        run(bench, "train", B, S, D, T, tokens, [&](){ module.zero_grad(); forward().sum().backward(); });
+                    };
+                    if (enabled("attention")){
+                        MultiHeadAttention attn(D, D, S, droprate, H, qkv_bias);
+                        run_module("attention", *attn, [&](){ return attn->forward(x); });
+                    }
+                    if (enabled("feedforward")){
+                        FeedForward ff(D);
+                        run_module("feedforward", *ff, [&](){ return ff->forward(x); });
+                    }
+                    if (enabled("block")){
+                        TransformerBlock block(D, S, droprate, H, qkv_bias);
+                        run_module("block", *block, [&](){ return block->forward(x); });
+                    }
+                    if (enabled("gpt2")){
+                        po::variables_map model_vm;
+                        Set_Value(model_vm, "vocab_size", (size_t)V);
+                        Set_Value(model_vm, "emb_dim", D);
+                        Set_Value(model_vm, "sequence", S);
+                        Set_Value(model_vm, "droprate", droprate);
+                        Set_Value(model_vm, "n_layers", vm["n_layers"].as<size_t>());
+                        Set_Value(model_vm, "n_heads", (size_t)H);
+                        Set_Value(model_vm, "qkv_bias", qkv_bias);
+                        Set_Value(model_vm, "doc_mask", false);
+                        Set_Value(model_vm, "endoftext", 0);
+                        Set_Value(model_vm, "checkpoint_every", (size_t)0);
+                        GPT2 gpt2(model_vm);
+                        Loss criterion(/*ignore_index=*/-100);
+                        gpt2->to(device);
+                        gpt2->eval();
+                        {
+                            torch::NoGradGuard no_grad;
+                            run("gpt2", "forward", B, S, D, T, tokens, [&](){ gpt2->forward(ids); });
+                        }
+                        gpt2->train();
+                        run("gpt2", "train", B, S, D, T, tokens, [&](){ gpt2->zero_grad(); criterion(gpt2->forward(ids), target).backward(); });
+                    }
+
+                    // (4.2) Loss, Sampling and Data Loader (independent of emb_dim)
+                    if (D != vm["emb_dim"].as<std::vector<size_t>>().front()) continue;
+                    if (enabled("loss")){
+                        Loss criterion(/*ignore_index=*/-100);
+                        torch::Tensor logits = torch::randn({(long int)B, (long int)S, V}, torch::TensorOptions().device(device)).requires_grad_(true);
+                        {
+                            torch::NoGradGuard no_grad;
+                            run("loss", "forward", B, S, 0, T, tokens, [&](){ criterion(logits, target); });
+                        }
+                        run("loss", "train", B, S, 0, T, tokens, [&](){ logits.mutable_grad() = torch::Tensor(); criterion(logits, target).backward(); });
+                    }
+                    if (enabled("sample") && (S == vm["sequence"].as<std::vector<size_t>>().front())){
+                        torch::Tensor logits = torch::randn({(long int)B, V}, torch::TensorOptions().device(device));
+                        run("sample", "forward", B, 0, 0, T, (double)B, [&](){ Sample_TopK(logits, vm["temperature"].as<float>(), vm["topk"].as<size_t>()); });
+                    }
+
+                    // (4.3) Batches of the Data Loader (on CPU, workers = threads)
+                    if (enabled("dataloader")){
+                        std::vector<torch::Tensor> texts;
+                        std::tuple<torch::Tensor, torch::Tensor> data;
+                        for (size_t i = 0; i < vm["documents"].as<size_t>(); i++){
+                            texts.push_back(torch::randint(2, V, {(long int)vm["document_tokens"].as<size_t>()}, torch::kLong));
+                        }
+                        datasets::TextFolder dataset(texts, S, /*stride=*/1, /*padding=*/1);
+                        DataLoader::TextFolder dataloader(dataset, B, /*shuffle_=*/true, /*num_workers_=*/(T > 1) ? T : 0);
+                        run("dataloader", "batch", B, S, 0, T, tokens, [&](){ if (!dataloader(data)) dataloader(data); });
+                    }
+
+                }
+            }
+        }
+    }
+
+    // (5) Write CSV
+    out_dir = vm["output_dir"].as<std::string>();  fs::create_directories(out_dir);
+    ofs.open(out_dir + "/bench.csv", std::ios::out);
+    ofs << "bench,mode,batch,sequence,emb_dim,threads,repeat,mean_ms,std_ms,min_ms,p50_ms,p90_ms,max_ms,tokens_per_s" << std::endl;
+    for (auto &r : results){
+        ofs << r.bench << ',' << r.mode << ',' << r.batch << ',' << r.sequence << ',' << r.emb_dim << ',' << r.threads << ',' << r.msec.size() << ',';
+        ofs << r.mean << ',' << r.stddev << ',' << r.min << ',' << r.p50 << ',' << r.p90 << ',' << r.max << ',' << r.tokens / r.mean * 1000.0 << std::endl;
+    }
+    ofs.close();
+
+    // (6) Write JSON
+    ofs.open(out_dir + "/bench.json", std::ios::out);
+    ofs << "{\"device\":\"" << device << "\",\"date\":\"" << progress::current_date() << "\",\"warmup\":" << warmup << ",\"repeat\":" << repeat << ",\"results\":[" << std::endl;
+    for (size_t i = 0; i < results.size(); i++){
+        Result &r = results.at(i);
+        ofs << "{\"bench\":\"" << r.bench << "\",\"mode\":\"" << r.mode << "\",\"batch\":" << r.batch << ",\"sequence\":" << r.sequence << ",\"emb_dim\":" << r.emb_dim << ",\"threads\":" << r.threads;
+        ofs << ",\"mean_ms\":" << r.mean << ",\"std_ms\":" << r.stddev << ",\"min_ms\":" << r.min << ",\"p50_ms\":" << r.p50 << ",\"p90_ms\":" << r.p90 << ",\"max_ms\":" << r.max;
+        ofs << ",\"tokens_per_s\":" << r.tokens / r.mean * 1000.0 << ",\"msec\":[";
+        for (size_t j = 0; j < r.msec.size(); j++) ofs << (j > 0 ? "," : "") << r.msec.at(j);
+        ofs << "]}" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    ofs << "]}" << std::endl;
+    ofs.close();
+    std::cout << "result : " << out_dir << "/bench.json, " << out_dir << "/bench.csv" << std::endl;
+
+    // End Processing
+    return 0;
+
+}
+
+
+// -----------------------------------
+// 4. Splitting Function
+// -----------------------------------
+std::vector<std::string> Split(const std::string &str){
+    std::vector<std::string> items;
+    std::string item;
+    std::stringstream ss(str);
+    while (std::getline(ss, item, ',')){
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+
+// -----------------------------------
+// 5. Option Setting Function
+// -----------------------------------
+// Options read by the constructor of GPT2Impl, set without the command line.
+template <typename T>
+void Set_Value(po::variables_map &vm, const std::string key, const T value){
+    vm.insert({key, po::variable_value(boost::any(value), false)});
+    return;
+}
@@ -0,0 +1,80 @@
+#include <iostream>                    // std::cout
+#include <fstream>                     // std::ofstream
+#include <filesystem>                  // std::filesystem
+#include <string>                      // std::string
+#include <sstream>                     // std::stringstream
+#include <vector>                      // std::vector
+#include <ios>                         // std::fixed
+#include <iomanip>                     // std::setw, std::setprecision
+// For External Library
+#include <torch/torch.h>               // torch
+#include <tokenizers_cpp.h>            // Tokenizer
+#include <boost/program_options.hpp>   // boost::program_options
+// For Original Header
+#include "datasets.hpp"                // datasets::TextFolder
+#include "progress.hpp"                // progress
+
+// Define Namespace
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+using tokenizers::Tokenizer;
+
+
+// -------------------------
+// Load Benchmark Function
+// -------------------------
+void load_bench(po::variables_map &vm, std::shared_ptr<tokenizers::Tokenizer> &tokenizer){
+
+    // (0) Initialization and Declaration
+    double files_per_sec, tokens_per_sec, base_sec;
+    std::string dataroot, path;
+    std::string date;
+    std::ofstream ofs;
+    std::stringstream ss;
+    std::vector<size_t> workers_list;
+    datasets::TextFolder dataset;
+    datasets::LoadStats stats;
+
+    // (1) Set Benchmark Conditions
+    dataroot = "datasets/" + vm["dataset"].as<std::string>() + "/" + vm["train_dir"].as<std::string>();
+    workers_list = {0};
+    if (vm["load_workers"].as<size_t>() > 0) workers_list.push_back(vm["load_workers"].as<size_t>());
+
+    // (2) File Open
+    path = "checkpoints/" + vm["dataset"].as<std::string>() + "/log";  fs::create_directories(path);
+    ofs.open(path + "/load_bench.txt", std::ios::app);
+    date = progress::separator_center("Load Benchmark (" + progress::current_date() + ")");
+    std::cout << date << std::endl;
+    ofs << date << std::endl;
+
+    // (3) Load Dataset per the Number of Workers
+    base_sec = 0.0;
+    for (auto &workers : workers_list){
+
+        dataset = datasets::TextFolder(dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>(), workers);
+        stats = dataset.load_stats();
+        files_per_sec = (double)stats.files / stats.seconds;
+        tokens_per_sec = (double)stats.tokens / stats.seconds;
+        if (workers == 0) base_sec = stats.seconds;
+
+        ss.str(""); ss.clear(std::stringstream::goodbit);
+        ss << "workers:" << workers << ' ';
+        ss << "files:" << stats.files << ' ';
+        ss << "tokens:" << stats.tokens << ' ';
+        ss << "MB:" << std::fixed << std::setprecision(2) << (double)stats.bytes / 1e6 << ' ';
+        ss << "time:" << std::setprecision(3) << stats.seconds << "s ";
+        ss << "files/s:" << std::setprecision(1) << files_per_sec << ' ';
+        ss << "tokens/s:" << std::setprecision(1) << tokens_per_sec << ' ';
+        ss << "speedup:x" << std::setprecision(2) << base_sec / stats.seconds;
+        std::cout << ss.str() << std::endl;
+        ofs << ss.str() << std::endl;
+
+    }
+
+    // Post Processing
+    ofs.close();
+
+    // End Processing
+    return;
+
+}
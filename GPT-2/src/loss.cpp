@@ -1,5 +1,7 @@
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <limits>
 // For External Library
 #include <torch/torch.h>
 // For Original Header
@@ -12,7 +14,9 @@ using torch::indexing::Slice;
 // class{Loss} -> constructor
 // -----------------------------------
 Loss::Loss(int ignore_index){
+    this->ignore_index = ignore_index;
     this->criterion = torch::nn::CrossEntropyLoss(torch::nn::CrossEntropyLossOptions().ignore_index(ignore_index).reduction(torch::kMean));
+    this->criterion_sum = torch::nn::CrossEntropyLoss(torch::nn::CrossEntropyLossOptions().ignore_index(ignore_index).reduction(torch::kSum));
 }
 
 
@@ -23,3 +27,133 @@ torch::Tensor Loss::operator()(torch::Tensor input, torch::Tensor target){
     torch::Tensor loss = criterion(input.view({-1, input.size(2)}), target.view({-1}));
     return loss;
 }
+
+
+// -----------------------------------
+// class{Loss} -> function{sum}
+// -----------------------------------
+// Sum over non-padding tokens, to be normalized by the number of tokens over several micro-batches.
+torch::Tensor Loss::sum(torch::Tensor input, torch::Tensor target){
+    torch::Tensor loss = criterion_sum(input.view({-1, input.size(2)}), target.view({-1}));
+    return loss;
+}
+
+
+// -----------------------------------
+// class{Loss} -> function{sequence}
+// -----------------------------------
+// Mean over non-padding tokens of each sequence : {N,S,V} ===> {N}
+torch::Tensor Loss::sequence(torch::Tensor input, torch::Tensor target){
+    torch::Tensor loss = torch::nn::functional::cross_entropy(input.view({-1, input.size(2)}), target.view({-1}), torch::nn::functional::CrossEntropyFuncOptions().ignore_index(this->ignore_index).reduction(torch::kNone));
+    torch::Tensor count = (target != this->ignore_index).sum(/*dim=*/1).clamp_min(1);  // {N}
+    return loss.view(target.sizes()).sum(/*dim=*/1) / count;
+}
+
+
+// -----------------------------------------------------------
+// struct{FusedLinearCrossEntropy}(autograd::Function)
+// -----------------------------------------------------------
+// Sum of cross-entropy of 'hidden x weight^T' over non-padding rows, computed in chunks of rows.
+// Gradients are computed in forward chunk by chunk, so that only the {C,V} logits of one chunk exist instead of {N*S,V};
+// the gradients of hidden {N*S,D} and weight {V,D} are kept from forward until backward.
+struct FusedLinearCrossEntropy : public torch::autograd::Function<FusedLinearCrossEntropy>{
+
+    static torch::Tensor forward(torch::autograd::AutogradContext *ctx, torch::Tensor hidden, torch::Tensor weight, torch::Tensor target, int64_t ignore_index, int64_t chunk_rows, bool grad_h, bool grad_w){
+
+        long int start, rows;
+        torch::Tensor hc, tc, mc, logits, lse, prob;
+        torch::Tensor loss, grad_hidden, grad_weight;
+
+        // (0) Gradient Buffers (only for the inputs that require them)
+        if (grad_h) grad_hidden = torch::empty_like(hidden, at::MemoryFormat::Contiguous);  // {N*S,D}
+        if (grad_w) grad_weight = torch::zeros_like(weight);  // {V,D}
+
+        // (1) Loss and Gradients per Chunk (padding rows are masked instead of gathered)
+        loss = torch::zeros({}, hidden.options());
+        for (start = 0; start < hidden.size(0); start += chunk_rows){
+            rows = std::min(chunk_rows, hidden.size(0) - start);
+            hc = hidden.narrow(0, start, rows);  // {C,D}
+            mc = (target.narrow(0, start, rows) != ignore_index).unsqueeze(1);  // {C,1}
+            tc = target.narrow(0, start, rows).unsqueeze(1).masked_fill(mc.logical_not(), 0);  // {C,1}
+            logits = hc.matmul(weight.t());  // {C,D} x {D,V} ===> {C,V}
+            lse = logits.logsumexp(/*dim=*/1, /*keepdim=*/true);  // {C,1}
+            loss += (lse - logits.gather(1, tc)).masked_fill_(mc.logical_not(), 0.0).sum();
+            if (!grad_h && !grad_w) continue;
+            prob = logits.sub_(lse).exp_();  // softmax {C,V} (in place of logits)
+            prob.scatter_add_(1, tc, torch::full({rows, 1}, -1.0, prob.options()));  // d(ce)/d(logits) = softmax - onehot
+            prob.masked_fill_(mc.logical_not(), 0.0);  // no gradient from padding rows
+            if (grad_h) torch::mm_out(grad_hidden.narrow(0, start, rows), prob, weight);  // {C,V} x {V,D} ===> {C,D}
+            if (grad_w) grad_weight.addmm_(prob.t(), hc);  // {V,C} x {C,D} ===> {V,D}
+        }
+
+        ctx->save_for_backward({grad_hidden, grad_weight});
+        return loss;
+
+    }
+
+    static torch::autograd::variable_list backward(torch::autograd::AutogradContext *ctx, torch::autograd::variable_list grad_output){
+        auto saved = ctx->get_saved_variables();
+        torch::Tensor g = grad_output.at(0);
+        torch::Tensor grad_hidden = saved.at(0).defined() ? saved.at(0) * g : torch::Tensor();
+        torch::Tensor grad_weight = saved.at(1).defined() ? saved.at(1) * g : torch::Tensor();
+        return {grad_hidden, grad_weight, torch::Tensor(), torch::Tensor(), torch::Tensor(), torch::Tensor(), torch::Tensor()};
+    }
+
+};
+
+
+// -----------------------------------
+// class{Loss} -> function{fused}
+// -----------------------------------
+// Sum of cross-entropy from the hidden state {N,S,D} and the weight of output head {V,D}, without {N,S,V} logits.
+// Rows are processed in chunks of at most 'chunk_elements' logits, so that memory does not grow with the batch.
+torch::Tensor Loss::fused(torch::Tensor hidden, torch::Tensor weight, torch::Tensor target, const size_t chunk_elements){
+    int64_t chunk_rows = std::max((int64_t)1, (int64_t)chunk_elements / weight.size(0));
+    bool grad = torch::GradMode::is_enabled();  // forward of autograd::Function runs without grad mode, so it is checked here
+    torch::Tensor loss = FusedLinearCrossEntropy::apply(hidden.reshape({-1, hidden.size(2)}), weight, target.reshape({-1}), (int64_t)this->ignore_index, chunk_rows, grad && hidden.requires_grad(), grad && weight.requires_grad());
+    return loss;
+}
+
+
+// -----------------------------------
+// class{SampledLoss} -> constructor
+// -----------------------------------
+// The proposal distribution is the unigram frequency of the corpus smoothed with the power of 0.75.
+SampledLoss::SampledLoss(torch::Tensor counts, const size_t samples_, int ignore_index_, torch::Device device){
+    this->ignore_index = ignore_index_;
+    this->samples = samples_;
+    this->q = (counts.to(torch::kFloat) + 1.0).pow(0.75);
+    if ((0 <= this->ignore_index) && (this->ignore_index < this->q.size(0))) this->q[this->ignore_index] = 0.0;
+    this->q = (this->q / this->q.sum()).to(device);  // {V}
+    this->log_q = this->q.clamp_min(1e-30).log();  // {V}
+}
+
+
+// -----------------------------------
+// class{SampledLoss} -> operator
+// -----------------------------------
+// Sum of sampled softmax cross-entropy over non-padding rows.
+// The negatives are shared in the batch, the logits are corrected by log(Q), and accidental hits of the target are masked.
+torch::Tensor SampledLoss::operator()(torch::Tensor hidden, torch::Tensor weight, torch::Tensor target){
+
+    torch::Tensor h, t, idx, neg, true_logits, neg_logits, logits;
+
+    // (1) Select Non-Padding Rows
+    h = hidden.reshape({-1, hidden.size(2)});  // {N*S,D}
+    t = target.reshape({-1});  // {N*S}
+    idx = (t != this->ignore_index).nonzero().squeeze(1);
+    h = h.index_select(0, idx);  // {R,D}
+    t = t.index_select(0, idx);  // {R}
+
+    // (2) Draw Negatives from Proposal
+    neg = torch::multinomial(this->q, this->samples, /*replacement=*/true);  // {K}
+
+    // (3) Corrected Logits
+    true_logits = (h * weight.index_select(0, t)).sum(/*dim=*/1) - this->log_q.index_select(0, t);  // {R}
+    neg_logits = h.matmul(weight.index_select(0, neg).t()) - this->log_q.index_select(0, neg).unsqueeze(0);  // {R,D} x {D,K} ===> {R,K}
+    neg_logits = neg_logits.masked_fill(neg.unsqueeze(0) == t.unsqueeze(1), -std::numeric_limits<float>::infinity());  // {R,K}
+    logits = torch::cat({true_logits.unsqueeze(1), neg_logits}, /*dim=*/1);  // {R,1+K}
+
+    return (logits.logsumexp(/*dim=*/1) - true_logits).sum();
+
+}
@@ -11,10 +11,29 @@
 // -------------------
 class Loss{
 private:
-    torch::nn::CrossEntropyLoss criterion;
+    int ignore_index;
+    torch::nn::CrossEntropyLoss criterion, criterion_sum;
 public:
     Loss(int ignore_index);
     torch::Tensor operator()(torch::Tensor input, torch::Tensor target);
+    torch::Tensor sum(torch::Tensor input, torch::Tensor target);
+    torch::Tensor sequence(torch::Tensor input, torch::Tensor target);
+    torch::Tensor fused(torch::Tensor hidden, torch::Tensor weight, torch::Tensor target, const size_t chunk_elements);
+};
+
+
+// -------------------
+// class{SampledLoss}
+// -------------------
+class SampledLoss{
+private:
+    int ignore_index;
+    long int samples;
+    torch::Tensor q, log_q;
+public:
+    SampledLoss(){}
+    SampledLoss(torch::Tensor counts, const size_t samples_, int ignore_index_, torch::Device device);
+    torch::Tensor operator()(torch::Tensor hidden, torch::Tensor weight, torch::Tensor target);
 };
 
 
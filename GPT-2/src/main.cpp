@@ -3,6 +3,7 @@
 #include <filesystem>                  // std::filesystem
 #include <string>                      // std::string
 #include <vector>                      // std::vector
+#include <memory>                      // std::shared_ptr, std::make_shared
 #include <random>                      // std::random_device
 #include <cstdlib>                     // std::srand, std::rand
 // For External Library
@@ -11,6 +12,10 @@
 #include <boost/program_options.hpp>   // boost::program_options
 // For Original Header
 #include "networks.hpp"                // GPT2
+#include "datasets.hpp"                // datasets::Shard_Writer
+#include "optimizers.hpp"              // optimizers::AdamW
+#include "arena.hpp"                   // arena::ParamArena
+#include "perf.hpp"                    // perf
 
 // Define Namespace and class
 namespace fs = std::filesystem;
@@ -22,10 +27,14 @@ void train(po::variables_map &vm, torch::Device &device, GPT2 &model, std::share
 void test(po::variables_map &vm, torch::Device &device, GPT2 &model, std::shared_ptr<tokenizers::Tokenizer> &tokenizer);
 void predict(po::variables_map &vm, torch::Device &device, GPT2 &model, std::shared_ptr<tokenizers::Tokenizer> &tokenizer);
 void question(po::variables_map &vm, torch::Device &device, GPT2 &model, std::shared_ptr<tokenizers::Tokenizer> &tokenizer);
+void load_bench(po::variables_map &vm, std::shared_ptr<tokenizers::Tokenizer> &tokenizer);
+void optim_bench(po::variables_map &vm, torch::Device &device, GPT2 &model);
+void plan(po::variables_map &vm, torch::Device &device);
 torch::Device Set_Device(po::variables_map &vm);
 std::string LoadBytesFromFile(const std::string& path);
 template <typename T> void Set_Model_Params(po::variables_map &vm, T &model, const std::string name);
 void Set_Options(po::variables_map &vm, int argc, const char *argv[], po::options_description &args, const std::string mode);
+std::shared_ptr<torch::optim::Optimizer> Set_Optimizer(po::variables_map &vm, GPT2 &model, std::shared_ptr<arena::ParamArena> param_arena);
 
 
 // -----------------------------------
@@ -43,22 +52,45 @@ po::options_description parse_arguments(){
         ("tokenizer", po::value<std::string>()->default_value("dist/tokenizer.json"), "tokenizer file name")
         ("vocab_size", po::value<size_t>()->default_value(50277), "vocabulary size")
         ("sequence", po::value<size_t>()->default_value(256), "maximum sequence length")
-        ("stride", po::value<size_t>()->default_value(1), "stride of text sequence")
+        ("stride", po::value<size_t>()->default_value(1), "stride of text sequence (not used for training with '--tokens_per_epoch', which draws from every offset)")
         ("endoftext", po::value<int>()->default_value(0), "id of <|endoftext|>")
         ("padding", po::value<int>()->default_value(1), "id of <|padding|>")
+        ("load_workers", po::value<size_t>()->default_value(4), "the number of workers to read and tokenize dataset files")
         ("temperature", po::value<float>()->default_value(1.0), "sampling temperature for prediction")
         ("topk", po::value<size_t>()->default_value(50), "top-k for prediction")
         ("gpu_id", po::value<int>()->default_value(0), "cuda device : 'x=-1' is cpu device")
         ("seed_random", po::value<bool>()->default_value(false), "whether to make the seed of random number in a random")
         ("seed", po::value<int>()->default_value(0), "seed of random number")
+        ("profile", po::value<bool>()->default_value(false), "profiling of stages, layers and operators in train/test/predict on/off : ./checkpoints/<dataset>/log/profile_<mode>.{json,txt}")
+        ("profile_start", po::value<size_t>()->default_value(10), "the number of steps skipped before profiling")
+        ("profile_steps", po::value<size_t>()->default_value(20), "the number of steps profiled")
+        ("perf_json", po::value<std::string>()->default_value(""), "file of the startup time, steps/s, tokens/s and peak RSS of this run for 'scripts/perf.sh' : '' is off")
 
         // (2) Define for Training
         ("train", po::value<bool>()->default_value(false), "training mode on/off")
         ("train_dir", po::value<std::string>()->default_value("train"), "training data directory : ./datasets/<dataset>/<train_dir>/<data files>")
         ("epochs", po::value<size_t>()->default_value(200), "training total epoch")
         ("batch_size", po::value<size_t>()->default_value(8), "training batch size")
+        ("grad_accum_steps", po::value<size_t>()->default_value(1), "the number of micro-batches of '--batch_size' accumulated per optimizer step")
+        ("fused_loss", po::value<bool>()->default_value(false), "training loss computed together with the output head in chunks, without the logits of whole batch on/off")
+        ("loss_chunk", po::value<size_t>()->default_value(16777216), "the maximum number of logits computed at once by '--fused_loss'")
+        ("sampled_softmax", po::value<size_t>()->default_value(0), "the number of negatives of sampled softmax for training loss, drawn by corpus frequency : 'x=0' is full softmax (validation and test always use full softmax)")
         ("train_load_epoch", po::value<std::string>()->default_value(""), "epoch of model to resume learning")
         ("save_epoch", po::value<size_t>()->default_value(20), "frequency of epoch to save model and optimizer")
+        ("log_every", po::value<size_t>()->default_value(10), "the number of losses kept on the device and read back at once for the log (training steps and test data)")
+        ("render_graph", po::value<bool>()->default_value(true), "rendering of loss graphs by gnuplot in background during training on/off (the data is always written, and 'scripts/plot.sh' renders it on demand)")
+        ("save_inflight", po::value<size_t>()->default_value(2), "the maximum number of checkpoints written in background at once (training waits beyond this)")
+        ("train_stream", po::value<bool>()->default_value(false), "streaming of sharded training data on/off")
+        ("shard_dir", po::value<std::string>()->default_value("train_shards"), "sharded training data directory : ./datasets/<dataset>/<shard_dir>/<shard files>")
+        ("shuffle_buffer", po::value<size_t>()->default_value(8192), "the number of sequences in the shuffle buffer for streaming")
+        ("tokens_per_epoch", po::value<size_t>()->default_value(0), "training tokens per epoch drawn at random offsets, with documents weighted by their tokens without padding ('--stride' is ignored) : 'x=0' is every sequence with stride")
+        ("packing", po::value<bool>()->default_value(false), "packing of documents separated by <|endoftext|> instead of padding on/off (with '--stride <sequence>' for dense sequences)")
+        ("world_size", po::value<size_t>()->default_value(1), "the number of processes for data parallel training")
+        ("rank", po::value<size_t>()->default_value(0), "rank of this process for data parallel training : 'x=0' is the main process")
+        ("dist_store", po::value<std::string>()->default_value(""), "file for rendezvous of processes on one host : '' is ./checkpoints/<dataset>/dist_store")
+        ("master_addr", po::value<std::string>()->default_value(""), "address of the main process for rendezvous over TCP : '' uses the file of --dist_store")
+        ("master_port", po::value<int>()->default_value(29500), "port of the main process for rendezvous over TCP")
+        ("bucket_mb", po::value<size_t>()->default_value(25), "size of gradient buckets all-reduced together [MB]")
 
         // (3) Define for Validation
         ("valid", po::value<bool>()->default_value(false), "validation mode on/off")
@@ -71,6 +103,9 @@ po::options_description parse_arguments(){
         ("test_dir", po::value<std::string>()->default_value("test"), "test data directory : ./datasets/<dataset>/<test_dir>/<data files>")
         ("test_load_epoch", po::value<std::string>()->default_value("latest"), "training epoch used for testing")
         ("test_result_dir", po::value<std::string>()->default_value("test_result"), "test result directory : ./<test_result_dir>")
+        ("test_batch_size", po::value<size_t>()->default_value(1), "test batch size")
+        ("test_workers", po::value<size_t>()->default_value(0), "the number of workers to make test batches : 'x=0' is the main thread")
+        ("test_windows", po::value<bool>()->default_value(false), "loss of every window to the terminal and <test_result_dir>/loss.txt on/off (the summary is always written)")
 
         // (5) Define for Prediction
         ("predict", po::value<bool>()->default_value(false), "prediction mode on/off")
@@ -85,15 +120,32 @@ po::options_description parse_arguments(){
         ("question_load_epoch", po::value<std::string>()->default_value("latest"), "training epoch used for question")
         ("question_result_dir", po::value<std::string>()->default_value("question_result"), "question result directory : ./<question_result_dir>")
 
-        // (7) Define for Network Parameter
+        // (7) Define for Data Preparation and Benchmark
+        ("load_bench", po::value<bool>()->default_value(false), "benchmark of loading training dataset on/off")
+        ("optim_bench", po::value<bool>()->default_value(false), "benchmark of optimizer step time on/off")
+        ("optim_bench_steps", po::value<size_t>()->default_value(50), "the number of optimizer steps timed per optimizer")
+        ("make_shards", po::value<bool>()->default_value(false), "making shards of tokens from training dataset on/off : ./datasets/<dataset>/<train_dir> ==> ./datasets/<dataset>/<shard_dir>")
+        ("shard_tokens", po::value<size_t>()->default_value(16777216), "the number of tokens per shard")
+        ("plan", po::value<bool>()->default_value(false), "cost model of FLOPs per token, memory per batch and step time of the configuration on/off : ./checkpoints/<dataset>/log/plan.txt")
+        ("plan_memory", po::value<double>()->default_value(16.0), "memory budget of the device for '--plan' [GB]")
+        ("plan_gflops", po::value<double>()->default_value(0.0), "matmul throughput for '--plan' and the model FLOPs utilization of training [GFLOP/s] : 'x=0' is calibrated on the device")
+        ("train_calibrate", po::value<bool>()->default_value(false), "calibration of the matmul throughput at the start of training for the model FLOPs utilization with '--plan_gflops 0' on/off")
+
+        // (8) Define for Network Parameter
         ("lr", po::value<float>()->default_value(1e-4), "learning rate")
         ("beta1", po::value<float>()->default_value(0.9), "beta 1 in Adam of optimizer method")
         ("beta2", po::value<float>()->default_value(0.999), "beta 2 in Adam of optimizer method")
+        ("optim", po::value<std::string>()->default_value("adam"), "optimizer method : 'adam' (torch::optim::Adam), 'adamw_fused' (AdamW over flat buffers)")
+        ("weight_decay", po::value<float>()->default_value(0.01), "decoupled weight decay of 'adamw_fused' (not applied to LayerNorm and biases)")
+        ("optim_bits", po::value<size_t>()->default_value(32), "bits of the moments of 'adamw_fused' : 32 (float) or 8 (blockwise dynamic quantization)")
+        ("flat_params", po::value<bool>()->default_value(false), "parameters and gradients laid out in a few contiguous buffers (one per weight decay group) on/off")
         ("emb_dim", po::value<size_t>()->default_value(1024), "embedding feature dimensions")
         ("n_heads", po::value<size_t>()->default_value(16), "the number of heads")
         ("n_layers", po::value<size_t>()->default_value(24), "the number of layers")
         ("droprate", po::value<float>()->default_value(0.1), "the rate of dropout")
         ("qkv_bias", po::value<bool>()->default_value(false), "qkv bias")
+        ("doc_mask", po::value<bool>()->default_value(false), "masking of attention across documents separated by <|endoftext|> on/off")
+        ("checkpoint_every", po::value<size_t>()->default_value(0), "activation checkpointing of every k-th transformer block in training : 'x=0' is off, 'x=1' is all blocks")
 
     ;
     
@@ -108,6 +160,7 @@ po::options_description parse_arguments(){
 int main(int argc, const char *argv[]){
 
     // (1) Extract Arguments
+    perf::Get_Recorder();  // the origin of the startup time
     po::options_description args = parse_arguments();
     po::variables_map vm{};
     po::store(po::parse_command_line(argc, argv, args), vm);
@@ -117,6 +170,15 @@ int main(int argc, const char *argv[]){
         return 1;
     }
     
+    // (1.1) Only the Main Process writes to the Terminal in Data Parallel
+    if (vm["rank"].as<size_t>() > 0){
+        std::cout.setstate(std::ios::badbit);
+    }
+    if ((vm["world_size"].as<size_t>() > 1) && vm["seed_random"].as<bool>()){
+        std::cerr << "Error : '--seed_random true' is not supported in data parallel training, because all processes must shuffle the data in the same way." << std::endl;
+        return 1;
+    }
+    
     // (2) Select Device
     torch::Device device = Set_Device(vm);
     std::cout << "using device = " << device << std::endl;
@@ -139,42 +201,75 @@ int main(int argc, const char *argv[]){
     // (4) Set tokenizer
     auto blob = LoadBytesFromFile(vm["tokenizer"].as<std::string>());
     std::shared_ptr<tokenizers::Tokenizer> tokenizer = Tokenizer::FromBlobJSON(blob);
+
+    // (5) Make Directories
+    std::string dir = "checkpoints/" + vm["dataset"].as<std::string>();
+    fs::create_directories(dir);
+
+    // (6.1) Load Benchmark Phase (without network)
+    if (vm["load_bench"].as<bool>()){
+        Set_Options(vm, argc, argv, args, "load_bench");
+        load_bench(vm, tokenizer);
+        return 0;
+    }
+
+    // (6.2) Sharding Phase (without network)
+    if (vm["make_shards"].as<bool>()){
+        Set_Options(vm, argc, argv, args, "make_shards");
+        std::string root = "datasets/" + vm["dataset"].as<std::string>() + "/";
+        datasets::Shard_Writer(root + vm["train_dir"].as<std::string>(), root + vm["shard_dir"].as<std::string>(), tokenizer, vm["shard_tokens"].as<size_t>(), vm["load_workers"].as<size_t>());
+        return 0;
+    }
+
+    // (6.3) Planning Phase (without network)
+    if (vm["plan"].as<bool>()){
+        Set_Options(vm, argc, argv, args, "plan");
+        plan(vm, device);
+        return 0;
+    }
     
-    // (5) Define Network
+    // (7) Define Network
     GPT2 gpt2(vm);
     gpt2->to(device);
-    
-    // (6) Make Directories
-    std::string dir = "checkpoints/" + vm["dataset"].as<std::string>();
-    fs::create_directories(dir);
 
-    // (7) Save Model Parameters
-    Set_Model_Params(vm, gpt2, "GPT-2");
+    // (8) Save Model Parameters
+    if (vm["rank"].as<size_t>() == 0) Set_Model_Params(vm, gpt2, "GPT-2");
 
-    // (8.1) Training Phase
+    // (9.1) Training Phase
     if (vm["train"].as<bool>()){
-        Set_Options(vm, argc, argv, args, "train");
+        if (vm["rank"].as<size_t>() == 0) Set_Options(vm, argc, argv, args, "train");
         train(vm, device, gpt2, tokenizer);
     }
 
-    // (8.2) Test Phase
+    // (9.2) Optimizer Benchmark Phase
+    if (vm["optim_bench"].as<bool>()){
+        Set_Options(vm, argc, argv, args, "optim_bench");
+        optim_bench(vm, device, gpt2);
+    }
+
+    // (9.3) Test Phase
     if (vm["test"].as<bool>()){
         Set_Options(vm, argc, argv, args, "test");
         test(vm, device, gpt2, tokenizer);
     }
 
-    // (8.3) Prediction Phase
+    // (9.4) Prediction Phase
     if (vm["predict"].as<bool>()){
         Set_Options(vm, argc, argv, args, "predict");
         predict(vm, device, gpt2, tokenizer);
     }
 
-    // (8.4) Question Phase
+    // (9.5) Question Phase
     if (vm["question"].as<bool>()){
         Set_Options(vm, argc, argv, args, "question");
         question(vm, device, gpt2, tokenizer);
     }
 
+    // (10) Write Performance Record
+    if (!vm["perf_json"].as<std::string>().empty()){
+        perf::Get_Recorder().write(vm["perf_json"].as<std::string>());
+    }
+
     // End Processing
     return 0;
 
@@ -290,3 +385,27 @@ void Set_Options(po::variables_map &vm, int argc, const char *argv[], po::option
     return;
 
 }
+
+
+// -----------------------------------
+// 6. Optimizer Setting Function
+// -----------------------------------
+std::shared_ptr<torch::optim::Optimizer> Set_Optimizer(po::variables_map &vm, GPT2 &model, std::shared_ptr<arena::ParamArena> param_arena){
+
+    // (1) AdamW over Flat Buffers
+    if (vm["optim"].as<std::string>() == "adamw_fused"){
+        return std::make_shared<optimizers::AdamW>(model->parameters(), torch::optim::AdamWOptions(vm["lr"].as<float>()).betas({vm["beta1"].as<float>(), vm["beta2"].as<float>()}).weight_decay(vm["weight_decay"].as<float>()), vm["optim_bits"].as<size_t>(), param_arena);
+    }
+    else if (vm["optim_bits"].as<size_t>() != 32){
+        std::cerr << "Error : '--optim_bits' other than 32 requires '--optim adamw_fused'." << std::endl;
+        std::exit(1);
+    }
+    // (2) Adam
+    else if (vm["optim"].as<std::string>() == "adam"){
+        return std::make_shared<torch::optim::Adam>(model->parameters(), torch::optim::AdamOptions(vm["lr"].as<float>()).betas({vm["beta1"].as<float>(), vm["beta2"].as<float>()}));
+    }
+
+    std::cerr << "Error : The optimizer '" << vm["optim"].as<std::string>() << "' is not supported." << std::endl;
+    std::exit(1);
+
+}
@@ -1,9 +1,14 @@
+#include <string>
 #include <vector>
 #include <limits>
 #include <typeinfo>
 #include <cmath>
+#include <mutex>
+#include <memory>
+#include <utility>
 // For External Library
 #include <torch/torch.h>
+#include <ATen/record_function.h>
 // For Original Header
 #include "networks.hpp"
 
@@ -55,7 +60,7 @@ MultiHeadAttentionImpl::MultiHeadAttentionImpl(const long int d_in, const long i
 // ----------------------------------------------------------------------
 // struct{MultiHeadAttentionImpl}(nn::Module) -> function{forward}
 // ----------------------------------------------------------------------
-torch::Tensor MultiHeadAttentionImpl::forward(torch::Tensor x){
+torch::Tensor MultiHeadAttentionImpl::forward(torch::Tensor x, torch::Tensor doc_mask){
 
     torch::Tensor keys, queries, values, attn_scores, mask_bool, attn_weights, context_vec;
 
@@ -70,6 +75,7 @@ torch::Tensor MultiHeadAttentionImpl::forward(torch::Tensor x){
 
     attn_scores = queries.matmul(keys.transpose(2, 3));  // {N,H,S,S}
     mask_bool = this->mask.index({Slice(torch::indexing::None, x.size(1)), Slice(torch::indexing::None, x.size(1))});  // {S,S}
+    if (doc_mask.defined()) mask_bool = mask_bool.logical_or(doc_mask.logical_not().unsqueeze(1));  // {S,S} + {N,1,S,S} ===> {N,1,S,S}
     attn_scores = attn_scores.masked_fill(mask_bool, -std::numeric_limits<float>::infinity());  // {N,H,S,S}
     attn_weights = torch::softmax((attn_scores / std::sqrt(keys.size(3))), -1);  // {N,H,S,S}
     attn_weights = this->dropout->forward(attn_weights);  // {N,H,S,S}
@@ -97,19 +103,32 @@ TransformerBlockImpl::TransformerBlockImpl(const long int emb_dim, const long in
 // ----------------------------------------------------------------------
 // struct{TransformerBlockImpl}(nn::Module) -> function{forward}
 // ----------------------------------------------------------------------
-torch::Tensor TransformerBlockImpl::forward(torch::Tensor x){
+torch::Tensor TransformerBlockImpl::forward(torch::Tensor x, torch::Tensor doc_mask){
 
     torch::Tensor shortcut;
 
+    // Scopes are recorded only while profiling (--profile)
     shortcut = x;
-    x = this->norm1->forward(x);
-    x = this->attn->forward(x);
+    {
+        RECORD_USER_SCOPE("norm");
+        x = this->norm1->forward(x);
+    }
+    {
+        RECORD_USER_SCOPE("attn");
+        x = this->attn->forward(x, doc_mask);
+    }
     x = this->drop_shortcut->forward(x);
     x = x + shortcut;
 
     shortcut = x;
-    x = this->norm2->forward(x);
-    x = this->ff->forward(x);
+    {
+        RECORD_USER_SCOPE("norm");
+        x = this->norm2->forward(x);
+    }
+    {
+        RECORD_USER_SCOPE("ff");
+        x = this->ff->forward(x);
+    }
     x = this->drop_shortcut->forward(x);
     x = x + shortcut;
 
@@ -118,6 +137,67 @@ torch::Tensor TransformerBlockImpl::forward(torch::Tensor x){
 }
 
 
+// ----------------------------------------------------------------------
+// struct{CheckpointBlock}(autograd::Function)
+// ----------------------------------------------------------------------
+// Runs a TransformerBlock without keeping its intermediates, and recomputes them in backward.
+// The RNG state at forward is replayed in the recomputation, so that dropout draws the same masks.
+// The block is owned by the graph (through a capsule of saved_data), so that a retained graph never refers to a destroyed block.
+struct CheckpointBlockHolder : public torch::CustomClassHolder{
+    std::shared_ptr<TransformerBlockImpl> block;
+    CheckpointBlockHolder(std::shared_ptr<TransformerBlockImpl> block_) : block(std::move(block_)){}
+};
+
+struct CheckpointBlock : public torch::autograd::Function<CheckpointBlock>{
+
+    static torch::Tensor forward(torch::autograd::AutogradContext *ctx, torch::Tensor x, torch::Tensor doc_mask, std::shared_ptr<TransformerBlockImpl> block){
+        at::Generator gen = at::globalContext().defaultGenerator(x.device());
+        {
+            std::lock_guard<std::mutex> lock(gen.mutex());
+            ctx->saved_data["rng_state"] = gen.get_state();
+        }
+        ctx->saved_data["block"] = c10::IValue::make_capsule(c10::make_intrusive<CheckpointBlockHolder>(block));
+        ctx->save_for_backward({x, doc_mask});
+        return block->forward(x, doc_mask);
+    }
+
+    static torch::autograd::variable_list backward(torch::autograd::AutogradContext *ctx, torch::autograd::variable_list grad_output){
+
+        torch::Tensor x, doc_mask, y, rng_state;
+        std::shared_ptr<TransformerBlockImpl> block;
+
+        // (1) Restore Input
+        auto saved = ctx->get_saved_variables();
+        x = saved.at(0).detach().requires_grad_(true);
+        doc_mask = saved.at(1);
+        block = c10::static_intrusive_pointer_cast<CheckpointBlockHolder>(ctx->saved_data["block"].toCapsule())->block;
+
+        // (2) Recompute Forward with the RNG State at Forward
+        at::Generator gen = at::globalContext().defaultGenerator(x.device());
+        {
+            std::lock_guard<std::mutex> lock(gen.mutex());
+            rng_state = gen.get_state();
+            gen.set_state(ctx->saved_data["rng_state"].toTensor());
+        }
+        {
+            torch::AutoGradMode enable_grad(true);
+            y = block->forward(x, doc_mask);
+        }
+        {
+            std::lock_guard<std::mutex> lock(gen.mutex());
+            gen.set_state(rng_state);
+        }
+
+        // (3) Backward through the Block (gradients of parameters are accumulated here)
+        torch::autograd::backward({y}, {grad_output.at(0)});
+
+        return {x.grad(), torch::Tensor(), torch::Tensor()};
+
+    }
+
+};
+
+
 // ----------------------------------------------------------------------
 // struct{GPT2Impl}(nn::Module) -> constructor
 // ----------------------------------------------------------------------
@@ -134,7 +214,11 @@ GPT2Impl::GPT2Impl(po::variables_map &vm){
 
     this->final_norm = register_module("final_norm", nn::LayerNorm(nn::LayerNormOptions({(long int)vm["emb_dim"].as<size_t>()})));
     this->out_head = register_module("out_head", nn::Linear(nn::LinearOptions(vm["emb_dim"].as<size_t>(), vm["vocab_size"].as<size_t>()).bias(false)));
-    
+
+    this->doc_mask = vm["doc_mask"].as<bool>();
+    this->endoftext = vm["endoftext"].as<int>();
+    this->checkpoint_every = vm["checkpoint_every"].as<size_t>();
+
 }
 
 
@@ -142,19 +226,57 @@ GPT2Impl::GPT2Impl(po::variables_map &vm){
 // struct{GPT2Impl}(nn::Module) -> function{forward}
 // ----------------------------------------------------------------------
 torch::Tensor GPT2Impl::forward(torch::Tensor x){
+    x = this->forward_hidden(x);
+    RECORD_USER_SCOPE("out_head");
+    return this->out_head->forward(x);  // {N,S,D} ===> {N,S,V}
+}
 
-    torch::Tensor token_embeds, pos_embeds, out;
 
-    token_embeds = this->token_emb->forward(x);
-    pos_embeds = this->pos_emb->forward(torch::arange(x.size(1)).to(x.device()));
-    x = token_embeds + pos_embeds;
+// ----------------------------------------------------------------------
+// struct{GPT2Impl}(nn::Module) -> function{forward_hidden}
+// ----------------------------------------------------------------------
+// Output of 'final_norm' before 'out_head' (for the loss computed together with 'out_head').
+torch::Tensor GPT2Impl::forward_hidden(torch::Tensor x){
+
+    torch::Tensor token_embeds, pos_embeds, eot, doc_idx, doc_mask;
+
+    if (this->doc_mask){
+        eot = (x == this->endoftext).to(torch::kLong);  // {N,S}
+        doc_idx = eot.cumsum(/*dim=*/1) - eot;  // {N,S} (<|endoftext|> belongs to the document it closes)
+        doc_mask = doc_idx.unsqueeze(2) == doc_idx.unsqueeze(1);  // {N,S,S}
+    }
+
+    {
+        RECORD_USER_SCOPE("token_emb");
+        token_embeds = this->token_emb->forward(x);
+        pos_embeds = this->pos_emb->forward(torch::arange(x.size(1)).to(x.device()));
+        x = token_embeds + pos_embeds;
+    }
     x = this->drop_emb->forward(x);
-    x = this->transformer->forward(x);
-    x = this->final_norm->forward(x);
-    out = this->out_head->forward(x);
+    for (size_t i = 0; i < this->transformer->size(); i++){
+        RECORD_USER_SCOPE("block" + std::to_string(i));
+        if (this->is_training() && (this->checkpoint_every > 0) && (i % this->checkpoint_every == 0)){
+            x = CheckpointBlock::apply(x, doc_mask, this->transformer->ptr<TransformerBlockImpl>(i));
+        }
+        else{
+            x = this->transformer[i]->as<TransformerBlock>()->forward(x, doc_mask);
+        }
+    }
+    {
+        RECORD_USER_SCOPE("final_norm");
+        x = this->final_norm->forward(x);
+    }
+
+    return x;
 
-    return out;
+}
 
+
+// ----------------------------------------------------------------------
+// struct{GPT2Impl}(nn::Module) -> function{head_weight}
+// ----------------------------------------------------------------------
+torch::Tensor GPT2Impl::head_weight(){
+    return this->out_head->weight;  // {V,D}
 }
 
 
@@ -39,7 +39,7 @@ private:
 public:
     MultiHeadAttentionImpl(){}
     MultiHeadAttentionImpl(const long int d_in, const long int d_out, const long int sequence, const float droprate, const long int n_heads_, const bool qkv_bias);
-    torch::Tensor forward(torch::Tensor x);
+    torch::Tensor forward(torch::Tensor x, torch::Tensor doc_mask=torch::Tensor());
 };
 TORCH_MODULE(MultiHeadAttention);
 
@@ -56,7 +56,7 @@ private:
 public:
     TransformerBlockImpl(){}
     TransformerBlockImpl(const long int emb_dim, const long int sequence, const float droprate, const long int n_heads, const bool qkv_bias);
-    torch::Tensor forward(torch::Tensor x);
+    torch::Tensor forward(torch::Tensor x, torch::Tensor doc_mask=torch::Tensor());
 };
 TORCH_MODULE(TransformerBlock);
 
@@ -68,13 +68,18 @@ struct GPT2Impl : nn::Module{
 private:
     nn::Embedding token_emb{nullptr}, pos_emb{nullptr};
     nn::Dropout drop_emb{nullptr};
-    nn::Sequential transformer;
+    nn::ModuleList transformer;
     nn::LayerNorm final_norm{nullptr};
     nn::Linear out_head{nullptr};
+    bool doc_mask;
+    long int endoftext;
+    size_t checkpoint_every;
 public:
     GPT2Impl(){}
     GPT2Impl(po::variables_map &vm);
     torch::Tensor forward(torch::Tensor x);
+    torch::Tensor forward_hidden(torch::Tensor x);
+    torch::Tensor head_weight();
 };
 TORCH_MODULE(GPT2);
 
@@ -0,0 +1,93 @@
+#include <iostream>                    // std::cout
+#include <fstream>                     // std::ofstream
+#include <filesystem>                  // std::filesystem
+#include <string>                      // std::string
+#include <sstream>                     // std::stringstream
+#include <vector>                      // std::vector
+#include <memory>                      // std::shared_ptr
+#include <chrono>                      // std::chrono
+#include <ios>                         // std::fixed
+#include <iomanip>                     // std::setprecision
+// For External Library
+#include <torch/torch.h>               // torch
+#include <boost/program_options.hpp>   // boost::program_options
+// For Original Header
+#include "networks.hpp"                // GPT2
+#include "optimizers.hpp"              // optimizers::AdamW
+#include "progress.hpp"                // progress
+
+// Define Namespace
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+
+
+// ------------------------------
+// Optimizer Benchmark Function
+// ------------------------------
+void optim_bench(po::variables_map &vm, torch::Device &device, GPT2 &model){
+
+    constexpr size_t warmup_steps = 5;  // steps excluded from timing
+
+    // (0) Initialization and Declaration
+    size_t i, steps;
+    double msec, base_msec;
+    std::string path, date;
+    std::ofstream ofs;
+    std::stringstream ss;
+    std::chrono::steady_clock::time_point start, end;
+    std::shared_ptr<torch::optim::Optimizer> optimizer;
+    std::vector<std::string> optims;
+
+    // (1) File Open
+    path = "checkpoints/" + vm["dataset"].as<std::string>() + "/log";  fs::create_directories(path);
+    ofs.open(path + "/optim_bench.txt", std::ios::app);
+    date = progress::separator_center("Optimizer Benchmark (" + progress::current_date() + ")");
+    std::cout << date << std::endl;
+    ofs << date << std::endl;
+
+    // (2) Time Steps per Optimizer (with random gradients)
+    steps = vm["optim_bench_steps"].as<size_t>();
+    optims = {"adam", "adamw_fused", "adamw_fused_8bit"};
+    base_msec = 0.0;
+    for (auto &name : optims){
+
+        if (name == "adam"){
+            optimizer = std::make_shared<torch::optim::Adam>(model->parameters(), torch::optim::AdamOptions(vm["lr"].as<float>()).betas({vm["beta1"].as<float>(), vm["beta2"].as<float>()}));
+        }
+        else{
+            optimizer = std::make_shared<optimizers::AdamW>(model->parameters(), torch::optim::AdamWOptions(vm["lr"].as<float>()).betas({vm["beta1"].as<float>(), vm["beta2"].as<float>()}).weight_decay(vm["weight_decay"].as<float>()), (name == "adamw_fused_8bit") ? 8 : 32);
+        }
+        for (auto &param : model->parameters()){
+            if (param.grad().defined()) param.mutable_grad().normal_(0.0, 1e-3);
+            else param.mutable_grad() = torch::randn_like(param) * 1e-3;
+        }
+
+        for (i = 0; i < warmup_steps + steps; i++){
+            if (i == warmup_steps){
+                if (device.is_cuda()) torch::cuda::synchronize();
+                start = std::chrono::steady_clock::now();
+            }
+            optimizer->step();
+        }
+        if (device.is_cuda()) torch::cuda::synchronize();
+        end = std::chrono::steady_clock::now();
+        msec = std::chrono::duration<double, std::milli>(end - start).count() / (double)steps;
+        if (name == "adam") base_msec = msec;
+
+        ss.str(""); ss.clear(std::stringstream::goodbit);
+        ss << "optim:" << name << ' ';
+        ss << "params:" << model->parameters().size() << ' ';
+        ss << "step:" << std::fixed << std::setprecision(3) << msec << "ms ";
+        ss << "speedup:x" << std::setprecision(2) << base_msec / msec;
+        std::cout << ss.str() << std::endl;
+        ofs << ss.str() << std::endl;
+
+    }
+
+    // Post Processing
+    ofs.close();
+
+    // End Processing
+    return;
+
+}
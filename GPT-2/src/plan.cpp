@@ -0,0 +1,96 @@
+#include <iostream>                    // std::cout
+#include <fstream>                     // std::ofstream
+#include <filesystem>                  // std::filesystem
+#include <string>                      // std::string
+#include <sstream>                     // std::stringstream
+#include <vector>                      // std::vector
+#include <algorithm>                   // std::min, std::max
+#include <cmath>                       // std::floor
+#include <ios>                         // std::fixed
+#include <iomanip>                     // std::setprecision, std::setw
+// For External Library
+#include <torch/torch.h>               // torch
+#include <boost/program_options.hpp>   // boost::program_options
+// For Original Header
+#include "planner.hpp"                 // planner
+#include "progress.hpp"                // progress
+
+// Define Namespace
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+
+
+// ------------------------------
+// Planning Function
+// ------------------------------
+void plan(po::variables_map &vm, torch::Device &device){
+
+    constexpr double MB = 1024.0 * 1024.0;
+    constexpr size_t max_rows = 4096;  // the maximum rows of the calibration matmul
+
+    // (0) Initialization and Declaration
+    size_t batch_size, max_batch, batch;
+    double gflops, budget, step_flops, msec, act;
+    std::string path, date;
+    std::ofstream ofs;
+    std::stringstream ss;
+    std::vector<size_t> batches;
+    planner::Config cfg;
+    planner::Cost cost;
+
+    // (1) File Open
+    path = "checkpoints/" + vm["dataset"].as<std::string>() + "/log";  fs::create_directories(path);
+    ofs.open(path + "/plan.txt", std::ios::app);
+    date = progress::separator_center("Plan (" + progress::current_date() + ")");
+    std::cout << date << std::endl;
+    ofs << date << std::endl;
+
+    // (2) Estimate Costs of the Configuration
+    cfg = planner::Get_Config(vm);
+    cost = planner::Estimate(cfg);
+    batch_size = vm["batch_size"].as<size_t>();
+
+    // (3) Calibrate Matmul Throughput of the Device
+    gflops = vm["plan_gflops"].as<double>();
+    if (gflops <= 0.0) gflops = planner::Calibrate(device, (int64_t)std::min(batch_size * (size_t)cfg.sequence, max_rows), cfg.emb_dim);
+
+    // (4) Largest Batch in the Memory Budget
+    budget = vm["plan_memory"].as<double>() * 1024.0 * MB;
+    max_batch = (budget > cost.static_bytes) ? (size_t)std::floor((budget - cost.static_bytes) / cost.activation_bytes) : 0;
+
+    // (5) Summary
+    ss << std::fixed << std::setprecision(2);
+    ss << "config : vocab_size:" << cfg.vocab_size << " emb_dim:" << cfg.emb_dim << " n_heads:" << cfg.n_heads << " n_layers:" << cfg.n_layers << " sequence:" << cfg.sequence;
+    ss << " optim_bits:" << cfg.optim_bits << " checkpoint_every:" << cfg.checkpoint_every << " full_logits:" << (cfg.full_logits ? "true" : "false") << std::endl;
+    ss << "parameters : " << cost.params * 1e-6 << " M" << std::endl;
+    ss << "training FLOPs/token : " << cost.flops_per_token * 1e-9 << " GFLOP (+" << cost.recompute_per_token * 1e-9 << " GFLOP recomputed)" << std::endl;
+    ss << "static memory : " << cost.static_bytes / MB << " MB (weights, gradients, optimizer states)" << std::endl;
+    ss << "activations : " << cost.activation_bytes / MB << " MB/sequence" << std::endl;
+    ss << "matmul throughput : " << gflops << " GFLOP/s" << (vm["plan_gflops"].as<double>() > 0.0 ? " (given)" : " (calibrated)") << std::endl;
+    ss << "memory budget : " << vm["plan_memory"].as<double>() << " GB ==> largest batch_size:" << max_batch << std::endl;
+
+    // (6) Table of Batch Sizes (step time at the matmul throughput, so a lower bound)
+    for (batch = 1; batch <= std::max({max_batch, batch_size, (size_t)1}) * 2; batch *= 2) batches.push_back(batch);
+    if (std::find(batches.begin(), batches.end(), batch_size) == batches.end()) batches.push_back(batch_size);
+    if ((max_batch > 0) && (std::find(batches.begin(), batches.end(), max_batch) == batches.end())) batches.push_back(max_batch);
+    std::sort(batches.begin(), batches.end());
+    ss << std::endl;
+    ss << std::setw(10) << "batch" << std::setw(14) << "tokens/step" << std::setw(14) << "act[MB]" << std::setw(14) << "total[MB]" << std::setw(14) << "step[ms]" << std::setw(14) << "tokens/s" << std::setw(8) << "fits" << std::endl;
+    for (auto &b : batches){
+        act = cost.activation_bytes * (double)b;
+        step_flops = (cost.flops_per_token + cost.recompute_per_token) * (double)(b * cfg.sequence);
+        msec = step_flops / (gflops * 1e9) * 1000.0;
+        ss << std::setw(10) << b << std::setw(14) << b * cfg.sequence << std::setw(14) << act / MB << std::setw(14) << (cost.static_bytes + act) / MB;
+        ss << std::setw(14) << msec << std::setw(14) << (double)(b * cfg.sequence) / msec * 1000.0 << std::setw(8) << (b <= max_batch ? "yes" : "no");
+        ss << (b == batch_size ? "  <== --batch_size" : "") << std::endl;
+    }
+    std::cout << ss.str() << std::flush;
+    ofs << ss.str() << std::flush;
+
+    // Post Processing
+    ofs.close();
+
+    // End Processing
+    return;
+
+}
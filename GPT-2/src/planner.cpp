@@ -0,0 +1,109 @@
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+// For External Library
+#include <torch/torch.h>
+#include <ATen/CPUGeneratorImpl.h>
+#include <boost/program_options.hpp>
+// For Original Header
+#include "planner.hpp"
+#include "optimizers.hpp"
+
+// Define Namespace
+namespace po = boost::program_options;
+
+
+// -----------------------------------------------
+// namespace{planner} -> function{Get_Config}
+// -----------------------------------------------
+planner::Config planner::Get_Config(po::variables_map &vm){
+    Config cfg;
+    cfg.vocab_size = vm["vocab_size"].as<size_t>();
+    cfg.emb_dim = vm["emb_dim"].as<size_t>();
+    cfg.n_heads = vm["n_heads"].as<size_t>();
+    cfg.n_layers = vm["n_layers"].as<size_t>();
+    cfg.sequence = vm["sequence"].as<size_t>();
+    cfg.qkv_bias = vm["qkv_bias"].as<bool>();
+    cfg.full_logits = !vm["fused_loss"].as<bool>() && (vm["sampled_softmax"].as<size_t>() == 0);
+    cfg.optim_bits = (vm["optim"].as<std::string>() == "adamw_fused") ? vm["optim_bits"].as<size_t>() : 32;
+    cfg.checkpoint_every = vm["checkpoint_every"].as<size_t>();
+    return cfg;
+}
+
+
+// -----------------------------------------------
+// namespace{planner} -> function{Estimate}
+// -----------------------------------------------
+// Counts follow GPT2Impl: token_emb(V*D), pos_emb(S*D), L blocks, final_norm and out_head(D*V, no bias).
+// Matmuls cost 2 FLOPs per multiply-add in forward and twice that in backward, and attention is computed
+// over the whole (masked) S*S matrix. Activations count the tensors saved for backward in float.
+planner::Cost planner::Estimate(const Config &cfg){
+
+    const double V = cfg.vocab_size, D = cfg.emb_dim, H = cfg.n_heads, L = cfg.n_layers, S = cfg.sequence;
+
+    double block_params, block_flops, layer_bytes, ckpt_layers;
+    Cost cost;
+
+    // (1) Parameters
+    block_params = 12.0 * D * D + 10.0 * D + (cfg.qkv_bias ? 3.0 * D : 0.0);  // qkv, out_proj, ff (D->4D->D), 2 LayerNorms
+    cost.params = V * D + S * D + L * block_params + 2.0 * D + D * V;
+
+    // (2) FLOPs per Token
+    block_flops = 2.0 * 12.0 * D * D + 4.0 * S * D;  // linear layers, and Q*K^T with attention*V
+    cost.flops_per_token = 3.0 * (L * block_flops + 2.0 * D * V);
+    ckpt_layers = (cfg.checkpoint_every > 0) ? (double)((cfg.n_layers + cfg.checkpoint_every - 1) / cfg.checkpoint_every) : 0.0;
+    cost.recompute_per_token = ckpt_layers * block_flops;
+
+    // (3) Static Memory
+    cost.static_bytes = 2.0 * sizeof(float) * cost.params;  // weights and gradients
+    cost.static_bytes += (double)optimizers::State_Bytes((int64_t)cost.params, cfg.optim_bits);
+    cost.static_bytes += L * S * S;  // causal masks (bool)
+
+    // (4) Activations per Sequence
+    layer_bytes = sizeof(float) * (17.0 * D + 3.0 * H * S) + H * S + 2.0 * D;  // per token: norms, q/k/v, scores, softmax, dropout, ff hidden
+    cost.activation_bytes = (L - ckpt_layers) * layer_bytes + ckpt_layers * sizeof(float) * D;
+    if (ckpt_layers > 0.0) cost.activation_bytes += layer_bytes;  // one block recomputed at a time
+    cost.activation_bytes += sizeof(float) * 3.0 * D + D;  // embeddings, dropout and final_norm
+    if (cfg.full_logits) cost.activation_bytes += 2.0 * sizeof(float) * V;  // logits and log-softmax
+    cost.activation_bytes *= S;
+
+    return cost;
+
+}
+
+
+// -----------------------------------------------
+// namespace{planner} -> function{Calibrate}
+// -----------------------------------------------
+// Achieved GFLOP/s of the largest matmul of a block ([rows, D] x [D, 4D]) on the device.
+// The operands are drawn from a local generator, so that the global random states are left untouched.
+double planner::Calibrate(torch::Device &device, const int64_t rows, const int64_t emb_dim, const double seconds){
+
+    constexpr size_t warmup = 3;
+
+    size_t iters;
+    double elapsed;
+    torch::Tensor a, b, c;
+    std::chrono::steady_clock::time_point start;
+    at::Generator gen = at::detail::createCPUGenerator(/*seed_val=*/0);
+    torch::NoGradGuard no_grad;
+
+    a = torch::randn({rows, emb_dim}, gen).to(device);
+    b = torch::randn({emb_dim, 4 * emb_dim}, gen).to(device);
+    for (size_t i = 0; i < warmup; i++) c = torch::matmul(a, b);
+    if (device.is_cuda()) torch::cuda::synchronize();
+
+    iters = 0;
+    elapsed = 0.0;
+    start = std::chrono::steady_clock::now();
+    while (elapsed < seconds){
+        c = torch::matmul(a, b);
+        if (device.is_cuda()) torch::cuda::synchronize();
+        iters++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return 2.0 * (double)rows * (double)emb_dim * (double)(4 * emb_dim) * (double)iters / elapsed * 1e-9;
+
+}
@@ -0,0 +1,46 @@
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+#include <cstdint>
+// For External Library
+#include <torch/torch.h>
+#include <boost/program_options.hpp>
+
+// Define Namespace
+namespace po = boost::program_options;
+
+
+// -----------------------------------
+// namespace{planner}
+// -----------------------------------
+namespace planner{
+
+    // -----------------------------------
+    // namespace{planner} -> struct{Config}
+    // -----------------------------------
+    // The options GPT2Impl and the training loop are built from.
+    struct Config{
+        int64_t vocab_size, emb_dim, n_heads, n_layers, sequence;
+        bool qkv_bias, full_logits;
+        size_t optim_bits, checkpoint_every;
+    };
+
+    // -----------------------------------
+    // namespace{planner} -> struct{Cost}
+    // -----------------------------------
+    struct Cost{
+        double params;  // the number of parameters
+        double flops_per_token;  // model FLOPs of forward and backward per token (without recomputation)
+        double recompute_per_token;  // FLOPs of the forward recomputed by activation checkpointing per token
+        double static_bytes;  // weights, gradients, optimizer states and buffers
+        double activation_bytes;  // activations saved for backward per sequence (fp32, approximate)
+    };
+
+    // Function Prototype
+    Config Get_Config(po::variables_map &vm);
+    Cost Estimate(const Config &cfg);
+    double Calibrate(torch::Device &device, const int64_t rows, const int64_t emb_dim, const double seconds=0.5);
+
+}
+
+#endif
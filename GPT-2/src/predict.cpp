@@ -4,7 +4,6 @@
 #include <string>                      // std::string
 #include <utility>                     // std::pair
 #include <tuple>                       // std::tuple
-#include <algorithm>                   // std::min
 // For External Library
 #include <torch/torch.h>               // torch
 #include <tokenizers_cpp.h>            // Tokenizer
@@ -13,6 +12,9 @@
 #include "networks.hpp"                // GPT2
 #include "datasets.hpp"                // datasets::TextFolderPredictWithPaths
 #include "dataloader.hpp"              // DataLoader::TextFolderPredictWithPaths
+#include "profiler.hpp"                // profiler
+#include "perf.hpp"                    // perf
+#include "sampling.hpp"                // Sample_TopK
 
 // Define Namespace
 namespace fs = std::filesystem;
@@ -34,13 +36,13 @@ void predict(po::variables_map &vm, torch::Device &device, GPT2 &model, std::sha
     std::vector<int> ids;
     std::string text;
     std::tuple<torch::Tensor, std::vector<std::string>> data;
-    torch::Tensor input, output, topk_logits, topk_indices, masked, probs, next_id;
+    torch::Tensor input, output, next_id;
     datasets::TextFolderPredictWithPaths dataset;
     DataLoader::TextFolderPredictWithPaths dataloader;
 
     // (1) Get Prediction Dataset
     dataroot = "datasets/" + vm["dataset"].as<std::string>() + '/' + vm["predict_dir"].as<std::string>();
-    dataset = datasets::TextFolderPredictWithPaths(dataroot, tokenizer);
+    dataset = datasets::TextFolderPredictWithPaths(dataroot, tokenizer, vm["load_workers"].as<size_t>());
     dataloader = DataLoader::TextFolderPredictWithPaths(dataset, /*batch_size_=*/1, /*shuffle_=*/false, /*num_workers_=*/0);
     std::cout << "total prediction data : " << dataset.size() << std::endl << std::endl;
 
@@ -52,6 +54,8 @@ void predict(po::variables_map &vm, torch::Device &device, GPT2 &model, std::sha
     torch::NoGradGuard no_grad;
     model->eval();
     result_dir = vm["predict_result_dir"].as<std::string>();  fs::create_directories(result_dir);
+    profiler::Get_Recorder().setup(vm["profile"].as<bool>(), vm["profile_start"].as<size_t>(), vm["profile_steps"].as<size_t>(), "checkpoints/" + vm["dataset"].as<std::string>() + "/log/profile_predict", device.is_cuda());
+    perf::Get_Recorder().phase("predict");
     while (dataloader(data)){
 
         input = std::get<0>(data).to(device);
@@ -71,16 +75,19 @@ void predict(po::variables_map &vm, torch::Device &device, GPT2 &model, std::sha
                 input = input.index({Slice(), Slice(-vm["sequence"].as<size_t>(), torch::indexing::None)});
             }
 
-            output = model->forward(input);  // {1,S} ===> {1,S,V}
-            output = output.index({Slice(), -1, Slice()});  // {1,S,V} ===> {1,V}
-            output = output / vm["temperature"].as<float>();  // {1,V}
-            std::tie(topk_logits, topk_indices) = torch::topk(output, std::min(output.size(1), (long int)vm["topk"].as<size_t>()), /*dim=*/-1, /*largest=*/true, /*sorted=*/true);
-            masked = torch::full_like(output, -std::numeric_limits<float>::infinity());  // {1,V}
-            masked.scatter_(-1, topk_indices, topk_logits);
-            probs = torch::softmax(masked, -1);  // {1,V}
-            next_id = torch::multinomial(probs, 1);  // {1,V} ===> {1,1}
+            {
+                profiler::scope scope("forward");
+                output = model->forward(input);  // {1,S} ===> {1,S,V}
+            }
+            {
+                profiler::scope scope("sample");
+                output = output.index({Slice(), -1, Slice()});  // {1,S,V} ===> {1,V}
+                next_id = Sample_TopK(output, vm["temperature"].as<float>(), vm["topk"].as<size_t>());  // {1,V} ===> {1,1}
+                id = next_id.index({0, 0}).item<int>();
+            }
+            profiler::Get_Recorder().step();
+            perf::Get_Recorder().step(/*tokens=*/1.0);
 
-            id = next_id.index({0, 0}).item<int>();
             if (id == vm["endoftext"].as<int>()) break;
             text = tokenizer->Decode(std::vector<int>{id});
 
@@ -96,6 +103,7 @@ void predict(po::variables_map &vm, torch::Device &device, GPT2 &model, std::sha
         ofs.close();
 
     }
+    profiler::Get_Recorder().close();
 
     // End Processing
     return;
@@ -4,8 +4,6 @@
 #include <string>                      // std::string
 #include <utility>                     // std::pair
 #include <tuple>                       // std::tuple
-#include <algorithm>                   // std::min
-#include <limits>                      // std::numeric_limits
 // For External Library
 #include <torch/torch.h>               // torch
 #include <tokenizers_cpp.h>            // Tokenizer
@@ -14,6 +12,7 @@
 #include "networks.hpp"                // GPT2
 #include "datasets.hpp"                // datasets::TextFolderPredictWithPaths
 #include "dataloader.hpp"              // DataLoader::TextFolderPredictWithPaths
+#include "sampling.hpp"                // Sample_TopK
 
 // Define Namespace
 namespace fs = std::filesystem;
@@ -34,7 +33,7 @@ void question(po::variables_map &vm, torch::Device &device, GPT2 &model, std::sh
     std::vector<int> ids_int;
     std::vector<int64_t> ids;
     std::string text;
-    torch::Tensor input, output, topk_logits, topk_indices, masked, probs, next_id;
+    torch::Tensor input, output, next_id;
 
     // (1) Get Model
     path = "checkpoints/" + vm["dataset"].as<std::string>() + "/models/epoch_" + vm["question_load_epoch"].as<std::string>() + ".pth";
@@ -66,12 +65,7 @@ void question(po::variables_map &vm, torch::Device &device, GPT2 &model, std::sh
 
             output = model->forward(input);  // {1,S} ===> {1,S,V}
             output = output.index({Slice(), -1, Slice()});  // {1,S,V} ===> {1,V}
-            output = output / vm["temperature"].as<float>();  // {1,V}
-            std::tie(topk_logits, topk_indices) = torch::topk(output, std::min(output.size(1), (long int)vm["topk"].as<size_t>()), /*dim=*/-1, /*largest=*/true, /*sorted=*/true);
-            masked = torch::full_like(output, -std::numeric_limits<float>::infinity());  // {1,V}
-            masked.scatter_(-1, topk_indices, topk_logits);
-            probs = torch::softmax(masked, -1);  // {1,V}
-            next_id = torch::multinomial(probs, 1);  // {1,V} ===> {1,1}
+            next_id = Sample_TopK(output, vm["temperature"].as<float>(), vm["topk"].as<size_t>());  // {1,V} ===> {1,1}
 
             id = next_id.index({0, 0}).item<int>();
             if (id == vm["endoftext"].as<int>()) break;
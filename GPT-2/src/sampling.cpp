@@ -0,0 +1,22 @@
+#include <tuple>
+#include <limits>
+#include <algorithm>
+// For External Library
+#include <torch/torch.h>
+// For Original Header
+#include "sampling.hpp"
+
+
+// -----------------------------------
+// function{Sample_TopK}
+// -----------------------------------
+// Draws the next token from the top-k logits of the last position : {N,V} ===> {N,1}
+torch::Tensor Sample_TopK(torch::Tensor logits, const float temperature, const long int topk){
+    torch::Tensor topk_logits, topk_indices, masked, probs;
+    logits = logits / temperature;  // {N,V}
+    std::tie(topk_logits, topk_indices) = torch::topk(logits, std::min(logits.size(1), topk), /*dim=*/-1, /*largest=*/true, /*sorted=*/true);
+    masked = torch::full_like(logits, -std::numeric_limits<float>::infinity());  // {N,V}
+    masked.scatter_(-1, topk_indices, topk_logits);
+    probs = torch::softmax(masked, -1);  // {N,V}
+    return torch::multinomial(probs, 1);  // {N,V} ===> {N,1}
+}
@@ -0,0 +1,11 @@
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+// For External Library
+#include <torch/torch.h>
+
+// Function Prototype
+torch::Tensor Sample_TopK(torch::Tensor logits, const float temperature, const long int topk);
+
+
+#endif
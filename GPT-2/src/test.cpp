@@ -2,8 +2,12 @@
 #include <fstream>                     // std::ifstream, std::ofstream
 #include <filesystem>                  // std::filesystem
 #include <string>                      // std::string
+#include <sstream>                     // std::stringstream
 #include <chrono>                      // std::chrono
 #include <utility>                     // std::pair
+#include <vector>                      // std::vector
+#include <algorithm>                   // std::max, std::sort
+#include <cmath>                       // std::exp
 // For External Library
 #include <torch/torch.h>               // torch
 #include <tokenizers_cpp.h>            // Tokenizer
@@ -13,6 +17,8 @@
 #include "networks.hpp"                // GPT2
 #include "datasets.hpp"                // datasets::TextFolder
 #include "dataloader.hpp"              // DataLoader::TextFolder
+#include "profiler.hpp"                // profiler
+#include "perf.hpp"                    // perf
 
 // Define Namespace
 namespace fs = std::filesystem;
@@ -26,22 +32,27 @@ using tokenizers::Tokenizer;
 void test(po::variables_map &vm, torch::Device &device, GPT2 &model, std::shared_ptr<tokenizers::Tokenizer> &tokenizer){
 
     // (0) Initialization and Declaration
-    float ave_loss;
-    double seconds, ave_time;
-    size_t i;
+    bool windows;
+    size_t i, batches, log_every, window_idx;
+    long int sequence, overlap;
+    int padding;
+    double loss_sum, tokens, batch_tokens, seconds, ave_loss;
     std::string path, result_dir;
     std::string dataroot;
     std::ofstream ofs;
-    std::chrono::system_clock::time_point start, end;
+    std::stringstream ss;
+    std::chrono::steady_clock::time_point start, end, loop_start;
     std::tuple<torch::Tensor, torch::Tensor> data;
-    torch::Tensor input, output, gt, loss;
+    torch::Tensor input, output, gt, gt_scored, values, window_values;
+    std::vector<torch::Tensor> sums, windows_loss;
+    std::vector<double> latency;
     datasets::TextFolder dataset;
     DataLoader::TextFolder dataloader;
 
     // (1) Get Test Dataset
     dataroot = "datasets/" + vm["dataset"].as<std::string>() + '/' + vm["test_dir"].as<std::string>();
-    dataset = datasets::TextFolder(dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>());
-    dataloader = DataLoader::TextFolder(dataset, /*batch_size_=*/1, /*shuffle_=*/false, /*num_workers_=*/0);
+    dataset = datasets::TextFolder(dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>(), vm["load_workers"].as<size_t>());
+    dataloader = DataLoader::TextFolder(dataset, /*batch_size_=*/vm["test_batch_size"].as<size_t>(), /*shuffle_=*/false, /*num_workers_=*/vm["test_workers"].as<size_t>());
     std::cout << "total test data : " << dataset.size() << std::endl << std::endl;
 
     // (2) Get Model
@@ -49,50 +60,99 @@ void test(po::variables_map &vm, torch::Device &device, GPT2 &model, std::shared
     torch::load(model, path, device);
 
     // (3) Set Loss Function
-    auto criterion = Loss(vm["padding"].as<int>());
+    padding = vm["padding"].as<int>();
+    auto criterion = Loss(padding);
 
     // (4) Initialization of Value
-    ave_loss = 0.0;
-    ave_time = 0.0;
+    loss_sum = 0.0;
+    tokens = 0.0;
     i = 0;
+    batches = 0;
+    log_every = std::max((size_t)1, vm["log_every"].as<size_t>());
+    windows = vm["test_windows"].as<bool>();
+    window_idx = 0;
+    sequence = vm["sequence"].as<size_t>();
+    overlap = std::max((long int)0, sequence - (long int)vm["stride"].as<size_t>());  // targets already scored by the previous window
+
+    // (4.1) Record Losses kept on the Device at once ({loss sum, tokens} per batch, and the loss of each window)
+    auto flush_loss = [&](){
+        if (sums.empty()) return;
+        values = torch::stack(sums).to(torch::kCPU, torch::kDouble);  // {B,2}
+        for (long int k = 0; k < values.size(0); k++){
+            loss_sum += values.data_ptr<double>()[k * 2];
+            tokens += values.data_ptr<double>()[k * 2 + 1];
+        }
+        sums.clear();
+        if (windows){
+            window_values = torch::cat(windows_loss).to(torch::kCPU, torch::kFloat);
+            for (long int k = 0; k < window_values.numel(); k++){
+                std::cout << '<' << i << "> loss:" << window_values.data_ptr<float>()[k] << std::endl;
+                ofs << '<' << i << "> loss:" << window_values.data_ptr<float>()[k] << std::endl;
+                i++;
+            }
+            windows_loss.clear();
+        }
+    };
 
     // (5) Tensor Forward
     torch::NoGradGuard no_grad;
     model->eval();
     result_dir = vm["test_result_dir"].as<std::string>();  fs::create_directories(result_dir);
     ofs.open(result_dir + "/loss.txt", std::ios::out);
+    profiler::Get_Recorder().setup(vm["profile"].as<bool>(), vm["profile_start"].as<size_t>(), vm["profile_steps"].as<size_t>(), "checkpoints/" + vm["dataset"].as<std::string>() + "/log/profile_test", device.is_cuda());
+    perf::Get_Recorder().phase("test");
+    loop_start = std::chrono::steady_clock::now();
     while (dataloader(data)){
         
+        // Strided evaluation : every window but the first of each document scores only its last 'stride' targets, so that each token is scored once
+        gt_scored = std::get<1>(data).clone();
+        for (long int r = 0; r < gt_scored.size(0); r++, window_idx++){
+            if ((overlap > 0) && (dataset.offset(window_idx) > 0)) gt_scored[r].narrow(0, 0, overlap).fill_(padding);
+        }
+        batch_tokens = (gt_scored != padding).sum().item<double>();
         input = std::get<0>(data).to(device);
         gt = std::get<1>(data).to(device);
+        gt_scored = gt_scored.to(device);
         
-        if (!device.is_cpu()) torch::cuda::synchronize();
-        start = std::chrono::system_clock::now();
+        if (device.is_cuda()) torch::cuda::synchronize();
+        start = std::chrono::steady_clock::now();
         
-        output = model->forward(input);
-
-        if (!device.is_cpu()) torch::cuda::synchronize();
-        end = std::chrono::system_clock::now();
-        seconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() * 0.001 * 0.001;
-        
-        loss = criterion(output, gt);
+        {
+            profiler::scope scope("forward");
+            output = model->forward(input);
+        }
+
+        {
+            profiler::scope scope("loss");
+            sums.push_back(torch::stack({criterion.sum(output, gt_scored).to(torch::kDouble), torch::full({}, batch_tokens, torch::TensorOptions().dtype(torch::kDouble).device(device))}));
+            if (windows) windows_loss.push_back(criterion.sequence(output, gt));
+        }
+
+        if (device.is_cuda()) torch::cuda::synchronize();
+        end = std::chrono::steady_clock::now();
+        latency.push_back(std::chrono::duration<double, std::milli>(end - start).count());
         
-        ave_loss += loss.item<float>();
-        ave_time += seconds;
-
-        std::cout << '<' << i << "> loss:" << loss.item<float>() << std::endl;
-        ofs << '<' << i << "> loss:" << loss.item<float>() << std::endl;
-        i++;
+        batches++;
+        if (batches % log_every == 0) flush_loss();
+        profiler::Get_Recorder().step();
+        perf::Get_Recorder().step(/*tokens=*/batch_tokens);  // scored tokens, as 'tokens/s' below
 
     }
-
-    // (6) Calculate Average
-    ave_loss = ave_loss / (float)dataset.size();
-    ave_time = ave_time / (double)dataset.size();
+    flush_loss();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loop_start).count();
+    profiler::Get_Recorder().close();
+
+    // (6) Token-weighted Loss, Perplexity, Throughput and Latency of Batches (each token counted once)
+    ave_loss = loss_sum / std::max(tokens, 1.0);
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&](const double p){ return latency.empty() ? 0.0 : latency.at((size_t)(p * (double)(latency.size() - 1) + 0.5)); };
+    ss << "<All> " << "loss:" << ave_loss << " perplexity:" << std::exp(ave_loss);
+    ss << " (tokens:" << (size_t)tokens << " windows:" << dataset.size() << " batches:" << batches << " batch_size:" << vm["test_batch_size"].as<size_t>();
+    ss << " tokens/s:" << tokens / seconds << " latency p50:" << percentile(0.50) << "ms p99:" << percentile(0.99) << "ms)";
 
     // (7) Average Output
-    std::cout << "<All> " << "loss:" << ave_loss << " (time:" << ave_time << ')' << std::endl;
-    ofs << "<All> " << "loss:" << ave_loss << " (time:" << ave_time << ')' << std::endl;
+    std::cout << ss.str() << std::endl;
+    ofs << ss.str() << std::endl;
 
     // Post Processing
     ofs.close();
@@ -1,20 +1,33 @@
 #include <iostream>                    // std::cout, std::flush
-#include <fstream>                     // std::ifstream, std::ofstream
+#include <fstream>                     // std::ifstream
 #include <filesystem>                  // std::filesystem
 #include <string>                      // std::string
 #include <sstream>                     // std::stringstream
 #include <tuple>                       // std::tuple
 #include <vector>                      // std::vector
 #include <utility>                     // std::pair
+#include <chrono>                      // std::chrono
+#include <memory>                      // std::shared_ptr, std::make_shared
+#include <cstdlib>                     // std::exit
+#include <algorithm>                   // std::max
 // For External Library
 #include <torch/torch.h>               // torch
 #include <tokenizers_cpp.h>            // Tokenizer
 #include <boost/program_options.hpp>   // boost::program_options
 // For Original Header
-#include "loss.hpp"                    // Loss
+#include "loss.hpp"                    // Loss, SampledLoss
 #include "networks.hpp"                // GPT2
 #include "datasets.hpp"                // datasets::TextFolder
-#include "dataloader.hpp"              // DataLoader::TextFolder
+#include "dataloader.hpp"              // DataLoader::TextFolder, DataLoader::TextStream
+#include "distributed.hpp"             // distributed
+#include "arena.hpp"                   // arena::ParamArena
+#include "checkpoint.hpp"              // checkpoint::writer
+#include "metrics.hpp"                 // metrics::logger
+#include "profiler.hpp"                // profiler
+#include "memory.hpp"                  // memory
+#include "perf.hpp"                    // perf
+#include "optimizers.hpp"              // optimizers::State_Bytes
+#include "planner.hpp"                 // planner
 #include "visualizer.hpp"              // visualizer
 #include "progress.hpp"                // progress
 
@@ -24,7 +37,8 @@ namespace po = boost::program_options;
 using tokenizers::Tokenizer;
 
 // Function Prototype
-void valid(po::variables_map &vm, DataLoader::TextFolder &valid_dataloader, torch::Device &device, Loss &criterion, GPT2 &model, const size_t epoch, visualizer::graph &writer);
+void valid(po::variables_map &vm, DataLoader::TextFolder &valid_dataloader, torch::Device &device, Loss &criterion, GPT2 &model, const size_t epoch, visualizer::graph &writer, metrics::logger &logger, const size_t valid_log);
+std::shared_ptr<torch::optim::Optimizer> Set_Optimizer(po::variables_map &vm, GPT2 &model, std::shared_ptr<arena::ParamArena> param_arena);
 
 
 // -------------------
@@ -37,83 +51,199 @@ void train(po::variables_map &vm, torch::Device &device, GPT2 &model, std::share
     constexpr bool valid_shuffle = true;  // whether to shuffle the validation dataset
     constexpr size_t valid_workers = 4;  // the number of workers to retrieve data from the validation dataset
     constexpr size_t save_model_iter = 1000;  // iterations to save the model
+    constexpr size_t train_prefetch = 2;  // the number of shards read ahead in streaming
 
     // -----------------------------------
     // a0. Initialization and Declaration
     // -----------------------------------
 
+    size_t i;
     size_t epoch;
-    size_t total_iter;
+    size_t total_iter, total_steps, grad_accum_steps;
+    size_t micro_iter;
+    long int step_tokens;
+    float loss_value;
+    double loss_scale;
     size_t start_epoch, total_epoch;
-    size_t iter;
+    size_t iter, log_every;
+    size_t train_log, valid_log;
+    size_t world_size;
+    size_t resume_steps, resume_micro;
+    double useful_tokens, total_tokens;
+    double resume_tokens, resume_sec;
+    double epoch_sec, model_gflops, peak_gflops;
+    bool resume, append;
+    bool memory_first;
+    size_t grad_before, optim_before, activation;
+    planner::Cost plan_cost;
     std::string date, date_out;
     std::string buff, latest;
-    std::string checkpoint_dir, path;
-    std::string dataroot, valid_dataroot;
+    std::string checkpoint_dir, path, state_path;
+    std::string dataroot, valid_dataroot, shardroot, store_path;
     std::stringstream ss;
     std::ifstream infoi;
-    std::ofstream ofs, init, infoo;
+    std::vector<std::string> model_paths, optim_paths;
+    std::vector<float> resume_loss;
+    std::vector<std::pair<size_t, long int>> pending_info;
+    std::vector<std::pair<std::string, size_t>> memory_items;
     std::tuple<torch::Tensor, torch::Tensor> mini_batch;
-    torch::Tensor loss, input, output, gt;
+    torch::Tensor loss, loss_sum, step_loss, count, input, output, hidden, gt, useful;
+    torch::Tensor counts, resume_useful, resume_sum, rng_state, pending_values;
+    std::vector<torch::Tensor> pending_loss;
+    c10::IValue value;
+    std::vector<std::tuple<torch::Tensor, torch::Tensor>> micro_batches;
+    bool remaining;
+    bool train_stream, train_random;
+    std::chrono::steady_clock::time_point epoch_start, epoch_end;
     datasets::TextFolder dataset, valid_dataset;
+    datasets::TextShards shard_dataset;
     DataLoader::TextFolder dataloader, valid_dataloader;
+    DataLoader::TextFolderRandom random_dataloader;
+    DataLoader::TextStream stream_dataloader;
     visualizer::graph train_loss, valid_loss;
     progress::display *show_progress;
     progress::irregular irreg_progress;
+    SampledLoss sampled_criterion;
+    std::shared_ptr<distributed::group> pg;
+    std::shared_ptr<distributed::reducer> reducer;
+    std::shared_ptr<torch::optim::Optimizer> optimizer;
+    std::shared_ptr<arena::ParamArena> param_arena;
+    std::shared_ptr<checkpoint::writer> ckpt;
+    checkpoint::Stats ckpt_stats;
+    std::shared_ptr<metrics::logger> metrics_log;
+    memory::Process process_before, process_after;
+    memory::Device device_before, device_after;
+    torch::serialize::InputArchive state_in;
 
 
     // -----------------------------------
     // a1. Preparation
     // -----------------------------------
 
-    // (1) Get Training Dataset
-    dataroot = "datasets/" + vm["dataset"].as<std::string>() + "/" + vm["train_dir"].as<std::string>();
-    dataset = datasets::TextFolder(dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>());
-    dataloader = DataLoader::TextFolder(dataset, vm["batch_size"].as<size_t>(), /*shuffle_=*/train_shuffle, /*num_workers_=*/train_workers);
-    std::cout << "total training data : " << dataset.size() << std::endl;
+    // (0) Set Process Group for Data Parallel
+    world_size = vm["world_size"].as<size_t>();
+    store_path = vm["dist_store"].as<std::string>();
+    if (store_path == "") store_path = "checkpoints/" + vm["dataset"].as<std::string>() + "/dist_store";
+    pg = std::make_shared<distributed::group>(vm["rank"].as<size_t>(), world_size, store_path, vm["master_addr"].as<std::string>(), vm["master_port"].as<int>());
+    if ((world_size > 1) && vm["train_stream"].as<bool>()){
+        std::cerr << "Error : Streaming from shards is not supported in distributed training." << std::endl;
+        std::exit(1);
+    }
 
-    // (2) Get Validation Dataset
-    if (vm["valid"].as<bool>()){
+    // (1.1) Get Training Dataset (in memory)
+    train_stream = vm["train_stream"].as<bool>();
+    train_random = !train_stream && (vm["tokens_per_epoch"].as<size_t>() > 0);
+    if (!train_stream && !train_random){
+        dataroot = "datasets/" + vm["dataset"].as<std::string>() + "/" + vm["train_dir"].as<std::string>();
+        dataset = datasets::TextFolder(dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>(), vm["load_workers"].as<size_t>(), vm["packing"].as<bool>());
+        dataloader = DataLoader::TextFolder(dataset, vm["batch_size"].as<size_t>(), /*shuffle_=*/train_shuffle, /*num_workers_=*/train_workers);
+        if (world_size > 1) dataloader.shard(pg->get_rank(), world_size);
+        std::cout << "total training data : " << dataset.size() << " (useful tokens : " << dataset.useful_ratio() * 100.0 << "%)" << std::endl;
+    }
+    // (1.2) Get Training Dataset (in memory with random offsets)
+    else if (train_random){
+        dataroot = "datasets/" + vm["dataset"].as<std::string>() + "/" + vm["train_dir"].as<std::string>();
+        dataset = datasets::TextFolder(dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>(), vm["load_workers"].as<size_t>(), vm["packing"].as<bool>(), /*indexing=*/false);
+        random_dataloader = DataLoader::TextFolderRandom(dataset, vm["batch_size"].as<size_t>(), vm["tokens_per_epoch"].as<size_t>(), /*num_workers_=*/train_workers);
+        if (world_size > 1) random_dataloader.shard(pg->get_rank(), world_size);
+        std::cout << "total training documents : " << dataset.documents() << " (useful tokens : " << dataset.useful_ratio() * 100.0 << "%)" << std::endl;
+    }
+    // (1.3) Get Training Dataset (streaming from shards)
+    else{
+        shardroot = "datasets/" + vm["dataset"].as<std::string>() + "/" + vm["shard_dir"].as<std::string>();
+        shard_dataset = datasets::TextShards(shardroot, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>());
+        stream_dataloader = DataLoader::TextStream(shard_dataset, vm["batch_size"].as<size_t>(), /*shuffle_=*/train_shuffle, /*buffer_size_=*/vm["shuffle_buffer"].as<size_t>(), /*prefetch_=*/train_prefetch);
+        std::cout << "total training data : " << shard_dataset.size() << " (shards:" << shard_dataset.shards() << ")" << std::endl;
+    }
+    auto next_batch = [&](std::tuple<torch::Tensor, torch::Tensor> &data){
+        if (train_stream) return stream_dataloader(data);
+        if (train_random) return random_dataloader(data);
+        return dataloader(data);
+    };
+
+    // (1.4) Set Training State (the position in the epoch, random engines and progress) to resume from the next mini-batch
+    // Each process keeps its own state, because the shard of data and random numbers differ between processes.
+    state_path = "checkpoints/" + vm["dataset"].as<std::string>() + "/models/state_latest";
+    if (!pg->is_main()) state_path += ".rank" + std::to_string(pg->get_rank());
+    state_path += ".pth";
+    auto stage_state = [&](const size_t epoch_, const size_t steps_, const size_t micro_, const std::vector<float> loss_sum_, const double sec_){
+        torch::serialize::OutputArchive state_out;
+        if (train_stream) return;  // shards are read by a background thread, so that streaming restarts from the beginning of the epoch
+        state_out.write("epoch", c10::IValue((int64_t)epoch_));
+        state_out.write("steps", c10::IValue((int64_t)steps_));
+        state_out.write("micro", c10::IValue((int64_t)micro_));
+        state_out.write("world_size", c10::IValue((int64_t)world_size));
+        state_out.write("grad_accum_steps", c10::IValue((int64_t)grad_accum_steps));
+        state_out.write("loss_sum", torch::tensor(loss_sum_, torch::kFloat));
+        state_out.write("useful", useful.to(torch::kCPU));
+        state_out.write("total_tokens", c10::IValue(total_tokens));
+        state_out.write("elapsed", c10::IValue(sec_));
+        state_out.write("rng_cpu", at::globalContext().defaultGenerator(torch::kCPU).get_state());
+        if (device.is_cuda()) state_out.write("rng_cuda", at::globalContext().defaultGenerator(device).get_state());
+        if (train_random) random_dataloader.save_state(state_out);
+        else dataloader.save_state(state_out);
+        ckpt->stage_archive({state_path}, state_out);
+    };
+
+    // (2) Get Validation Dataset (only main process)
+    if (vm["valid"].as<bool>() && pg->is_main()){
         valid_dataroot = "datasets/" + vm["dataset"].as<std::string>() + "/" + vm["valid_dir"].as<std::string>();
-        valid_dataset = datasets::TextFolder(valid_dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>());
+        valid_dataset = datasets::TextFolder(valid_dataroot, tokenizer, vm["sequence"].as<size_t>(), vm["stride"].as<size_t>(), vm["endoftext"].as<int>(), vm["padding"].as<int>(), vm["load_workers"].as<size_t>());
         valid_dataloader = DataLoader::TextFolder(valid_dataset, vm["valid_batch_size"].as<size_t>(), /*shuffle_=*/valid_shuffle, /*num_workers_=*/valid_workers);
         std::cout << "total validation data : " << valid_dataset.size() << std::endl;
     }
 
     // (3) Set Optimizer Method
-    auto optimizer = torch::optim::Adam(model->parameters(), torch::optim::AdamOptions(vm["lr"].as<float>()).betas({vm["beta1"].as<float>(), vm["beta2"].as<float>()}));
+    if (vm["flat_params"].as<bool>()){
+        param_arena = std::make_shared<arena::ParamArena>(arena::Decay_Split(model->parameters()));
+        std::cout << "flat parameters : " << param_arena->numel() << " elements in " << param_arena->groups() << " buffers" << std::endl;
+    }
+    optimizer = Set_Optimizer(vm, model, param_arena);
+
+    // (3.1) Set Gradient Reducer for Data Parallel
+    if (world_size > 1){
+        reducer = std::make_shared<distributed::reducer>(pg, model->parameters(), vm["bucket_mb"].as<size_t>() << 20);
+    }
 
     // (4) Set Loss Function
     auto criterion = Loss(vm["padding"].as<int>());
+    if (vm["sampled_softmax"].as<size_t>() > 0){
+        if (train_stream){
+            counts = torch::zeros({(long int)vm["vocab_size"].as<size_t>()}, torch::kLong);  // uniform proposal (frequencies of shards are not counted)
+        }
+        else{
+            counts = dataset.token_counts(vm["vocab_size"].as<size_t>(), vm["padding"].as<int>());
+        }
+        sampled_criterion = SampledLoss(counts, vm["sampled_softmax"].as<size_t>(), vm["padding"].as<int>(), device);
+    }
 
     // (5) Make Directories
     checkpoint_dir = "checkpoints/" + vm["dataset"].as<std::string>();
     path = checkpoint_dir + "/models";  fs::create_directories(path);
     path = checkpoint_dir + "/optims";  fs::create_directories(path);
     path = checkpoint_dir + "/log";  fs::create_directories(path);
+    ckpt = std::make_shared<checkpoint::writer>(vm["save_inflight"].as<size_t>());
+    metrics_log = std::make_shared<metrics::logger>(/*enabled_=*/pg->is_main());
 
-    // (6) Set Training Loss for Graph
+    // (6) Set Training Loss for Graph (only main process)
     path = checkpoint_dir + "/graph";
-    train_loss = visualizer::graph(path, /*gname_=*/"train_loss", /*label_=*/{"Cross-Entropy"});
-    if (vm["valid"].as<bool>()){
-        valid_loss = visualizer::graph(path, /*gname_=*/"valid_loss", /*label_=*/{"Cross-Entropy"});
+    if (pg->is_main()){
+        train_loss = visualizer::graph(path, /*gname_=*/"train_loss", /*label_=*/{"Cross-Entropy"}, /*render_=*/vm["render_graph"].as<bool>());
+        if (vm["valid"].as<bool>()){
+            valid_loss = visualizer::graph(path, /*gname_=*/"valid_loss", /*label_=*/{"Cross-Entropy"}, /*render_=*/vm["render_graph"].as<bool>());
+        }
     }
     
-    // (7) Get Weights and File Processing
+    // (7) Get Weights
     if (vm["train_load_epoch"].as<std::string>() == ""){
         model->apply(weights_init);
-        ofs.open(checkpoint_dir + "/log/train.txt", std::ios::out);
-        if (vm["valid"].as<bool>()){
-            init.open(checkpoint_dir + "/log/valid.txt", std::ios::trunc);
-            init.close();
-        }
+        append = false;
         start_epoch = 0;
     }
     else{
         path = checkpoint_dir + "/models/epoch_" + vm["train_load_epoch"].as<std::string>() + ".pth";  torch::load(model, path, device);
-        path = checkpoint_dir + "/optims/epoch_" + vm["train_load_epoch"].as<std::string>() + ".pth";  torch::load(optimizer, path, device);
-        ofs.open(checkpoint_dir + "/log/train.txt", std::ios::app);
-        ofs << std::endl << std::endl;
+        path = checkpoint_dir + "/optims/epoch_" + vm["train_load_epoch"].as<std::string>() + ".pth";  torch::load(*optimizer, path, device);
+        append = true;
         if (vm["train_load_epoch"].as<std::string>() == "latest"){
             infoi.open(checkpoint_dir + "/models/info.txt", std::ios::in);
             std::getline(infoi, buff);
@@ -131,11 +261,93 @@ void train(po::variables_map &vm, torch::Device &device, GPT2 &model, std::share
         }
     }
 
+    // (7.1) Set Log Files (text views and CSV, written only by the main process in background)
+    train_log = metrics_log->add(checkpoint_dir + "/log/train.txt", checkpoint_dir + "/log/train.csv", {"epoch", "steps", "total_steps", "micro", "total_micro", "ce", "ce_ave"}, [](const double *v){
+        std::stringstream line;
+        line << "steps:" << (size_t)v[1] << '/' << (size_t)v[2] << ' ';
+        line << "micro:" << (size_t)v[3] << '/' << (size_t)v[4] << ' ';
+        line << "ce:" << (float)v[5] << "(ave:" << (float)v[6] << ')';
+        return line.str();
+    }, append);
+    if (append) metrics_log->text(train_log, "\n");
+    if (vm["valid"].as<bool>()){
+        valid_log = metrics_log->add(checkpoint_dir + "/log/valid.txt", checkpoint_dir + "/log/valid.csv", {"epoch", "total_epoch", "ce"}, [](const double *v){
+            std::stringstream line;
+            line << "epoch:" << (size_t)v[0] << '/' << (size_t)v[1] << ' ';
+            line << "ce:" << (float)v[2];
+            return line.str();
+        }, append);
+    }
+
+    // (7.2) Model FLOPs per Token and Matmul Throughput for the Utilization (same as '--plan', before the random states are restored)
+    plan_cost = planner::Estimate(planner::Get_Config(vm));
+    peak_gflops = vm["plan_gflops"].as<double>();
+    if ((peak_gflops <= 0.0) && vm["train_calibrate"].as<bool>() && pg->is_main()){
+        peak_gflops = planner::Calibrate(device, (int64_t)std::min(vm["batch_size"].as<size_t>() * vm["sequence"].as<size_t>(), (size_t)4096), vm["emb_dim"].as<size_t>());
+    }
+
+    // (7.3) Get Training State in the middle of the epoch
+    resume = false;
+    grad_accum_steps = std::max((size_t)1, vm["grad_accum_steps"].as<size_t>());
+    if ((vm["train_load_epoch"].as<std::string>() == "latest") && !train_stream && fs::exists(state_path)){
+        state_in.load_from(state_path);
+        state_in.read("epoch", value);
+        if ((size_t)value.toInt() == start_epoch + 1){
+            state_in.read("world_size", value);  resume = ((size_t)value.toInt() == world_size);
+            state_in.read("grad_accum_steps", value);  resume = resume && ((size_t)value.toInt() == grad_accum_steps);
+            if (!resume){
+                std::cerr << "Warning : The number of processes or accumulation steps differs from the saved state, so that the epoch restarts from the beginning." << std::endl;
+            }
+        }
+        if (resume){
+            state_in.read("steps", value);  resume_steps = value.toInt();
+            state_in.read("micro", value);  resume_micro = value.toInt();
+            state_in.read("total_tokens", value);  resume_tokens = value.toDouble();
+            state_in.read("elapsed", value);  resume_sec = value.toDouble();
+            state_in.read("useful", resume_useful);
+            state_in.read("loss_sum", resume_sum);
+            resume_loss = std::vector<float>(resume_sum.data_ptr<float>(), resume_sum.data_ptr<float>() + resume_sum.numel());
+            state_in.read("rng_cpu", rng_state);  at::globalContext().defaultGenerator(torch::kCPU).set_state(rng_state);
+            if (device.is_cuda() && state_in.try_read("rng_cuda", rng_state)) at::globalContext().defaultGenerator(device).set_state(rng_state);
+            if (train_random) random_dataloader.load_state(state_in);
+            else dataloader.load_state(state_in);
+            std::cout << "resume training : epoch " << start_epoch + 1 << " from step " << resume_steps << " (micro-batch " << resume_micro << ")" << std::endl;
+        }
+    }
+
+    // (7.4) Start from the same Weights on all Processes
+    if (param_arena) param_arena->attach();  // torch::load() re-points parameters
+    pg->broadcast(model->parameters());
+
+    // (7.5) Memory Report at Startup (gradients and states of torch::optim::Adam are allocated at the first step)
+    auto write_memory = [&](const std::string phase, const std::ios::openmode mode){
+        std::string report = memory::Report(phase, memory_items, device);
+        std::ofstream mem_ofs(checkpoint_dir + "/model_params/GPT-2_memory.txt", mode);
+        std::cout << report << std::flush;
+        mem_ofs << report << std::endl;
+        mem_ofs.close();
+    };
+    memory_first = pg->is_main();
+    if (memory_first){
+        memory_items = {
+            {"parameters", memory::Tensor_Bytes(model->parameters())},
+            {"buffers", memory::Tensor_Bytes(model->buffers())},
+            {"gradients (expected)", memory::Tensor_Bytes(model->parameters())},
+            {"optimizer states (expected)", std::max(memory::Optimizer_Bytes(*optimizer), optimizers::State_Bytes(param_arena ? param_arena->numel() : memory::Tensor_Bytes(model->parameters()) / sizeof(float), vm["optim"].as<std::string>() == "adam" ? 32 : vm["optim_bits"].as<size_t>()))}
+        };
+        if (!train_stream){
+            memory_items.push_back({"dataset tokens", dataset.token_bytes()});
+            memory_items.push_back({"dataset index", dataset.index_bytes()});
+        }
+        write_memory("startup", std::ios::out);
+    }
+
     // (8) Display Date
     date = progress::current_date();
     date = progress::separator_center("Train Loss (" + date + ")");
     std::cout << std::endl << std::endl << date << std::endl;
-    ofs << date << std::endl;
+    metrics_log->text(train_log, date);
+    perf::Get_Recorder().phase("train");
 
 
     // -----------------------------------
@@ -144,50 +356,178 @@ void train(po::variables_map &vm, torch::Device &device, GPT2 &model, std::share
     
     // (1) Set Parameters
     start_epoch++;
-    total_iter = dataloader.get_count_max();
+    total_iter = train_stream ? stream_dataloader.get_count_max() : (train_random ? random_dataloader.get_count_max() : dataloader.get_count_max());
+    total_steps = (total_iter + grad_accum_steps - 1) / grad_accum_steps;
     total_epoch = vm["epochs"].as<size_t>();
+    log_every = std::max((size_t)1, vm["log_every"].as<size_t>());
+    profiler::Get_Recorder().setup(vm["profile"].as<bool>() && pg->is_main(), vm["profile_start"].as<size_t>(), vm["profile_steps"].as<size_t>(), checkpoint_dir + "/log/profile_train", device.is_cuda());
+
+    // (1.1) Record Losses kept on the Device (one read back per 'log_every' steps instead of a device sync per step)
+    auto flush_loss = [&](){
+        if (pending_loss.empty()) return;
+        pending_values = torch::stack(pending_loss).to(torch::kCPU);
+        for (size_t k = 0; k < pending_loss.size(); k++){
+            loss_value = pending_values.data_ptr<float>()[k] / (float)std::max(pending_info.at(k).second, 1L);
+            show_progress->increment(/*loss_value=*/{loss_value});
+            metrics_log->push(train_log, {(double)epoch, (double)show_progress->get_iters(), (double)total_steps, (double)pending_info.at(k).first, (double)total_iter, loss_value, show_progress->get_ave(0)});
+        }
+        pending_loss.clear();
+        pending_info.clear();
+    };
 
     // (2) Training per Epoch
     irreg_progress.restart(start_epoch - 1, total_epoch);
     for (epoch = start_epoch; epoch <= total_epoch; epoch++){
 
         model->train();
-        ofs << std::endl << "epoch:" << epoch << '/' << total_epoch << std::endl;
-        show_progress = new progress::display(/*count_max_=*/total_iter, /*epoch=*/{epoch, total_epoch}, /*loss_=*/{"ce"});
+        metrics_log->text(train_log, "\nepoch:" + std::to_string(epoch) + '/' + std::to_string(total_epoch));
+        show_progress = new progress::display(/*count_max_=*/total_steps, /*epoch=*/{epoch, total_epoch}, /*loss_=*/{"ce"});
+        micro_iter = 0;
+        iter = 0;
+        remaining = true;
+        useful = torch::zeros({}, torch::TensorOptions().dtype(torch::kLong).device(device));
+        total_tokens = 0.0;
+        epoch_start = std::chrono::steady_clock::now();
+        if (resume){
+            show_progress->restore(resume_steps, resume_loss);
+            micro_iter = resume_micro;
+            iter = resume_steps;
+            useful = resume_useful.to(device);
+            total_tokens = resume_tokens;
+            epoch_start -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(resume_sec));
+            resume = false;
+        }
 
         // -----------------------------------
         // b1. Mini Batch Learning
         // -----------------------------------
-        while (dataloader(mini_batch)){
+        while (remaining){
+
+            // -----------------------------------
+            // c0. Get Micro Batches for one Optimizer Step
+            // -----------------------------------
+            micro_batches.clear();
+            {
+                profiler::scope scope("data");
+                while (micro_batches.size() < grad_accum_steps){
+                    if (!next_batch(mini_batch)){
+                        remaining = false;
+                        break;
+                    }
+                    micro_batches.push_back(mini_batch);
+                }
+            }
+            if (micro_batches.empty()) break;
+
+            // Normalize the loss by the number of non-padding tokens over all micro-batches (and all processes)
+            step_tokens = 0;
+            for (auto &micro_batch : micro_batches){
+                step_tokens += (std::get<1>(micro_batch) != vm["padding"].as<int>()).sum().item<long int>();
+            }
+            count = torch::full({}, step_tokens, torch::TensorOptions().dtype(torch::kLong));
+            pg->allreduce(count);
+            // The reducer averages gradients over processes, so that the global sum is restored with 'world_size'
+            loss_scale = (double)world_size / (double)std::max(count.item<long int>(), 1L);
 
             // -----------------------------------
             // c1. Auto Encoder Training Phase
             // -----------------------------------
-            input = std::get<0>(mini_batch).to(device);
-            gt = std::get<1>(mini_batch).to(device);
-            output = model->forward(input);
-            loss = criterion(output, gt);
-            optimizer.zero_grad();
-            loss.backward();
-            optimizer.step();
+            if (memory_first){
+                memory::Reset_Peak(device);
+                process_before = memory::Process_Usage();
+                device_before = memory::Device_Usage(device);
+                grad_before = memory::Grad_Bytes(model->parameters());
+                optim_before = memory::Optimizer_Bytes(*optimizer);
+            }
+            if (param_arena) param_arena->zero_grad();
+            else optimizer->zero_grad(/*set_to_none=*/false);
+            step_loss = torch::zeros({}, torch::TensorOptions().device(device));
+            for (i = 0; i < micro_batches.size(); i++){
+                input = std::get<0>(micro_batches.at(i)).to(device);
+                gt = std::get<1>(micro_batches.at(i)).to(device);
+                {
+                    profiler::scope scope("forward");
+                    if ((vm["sampled_softmax"].as<size_t>() > 0) || vm["fused_loss"].as<bool>()) hidden = model->forward_hidden(input);
+                    else output = model->forward(input);
+                }
+                {
+                    profiler::scope scope("loss");
+                    if (vm["sampled_softmax"].as<size_t>() > 0){
+                        loss_sum = sampled_criterion(hidden, model->head_weight(), gt);
+                    }
+                    else if (vm["fused_loss"].as<bool>()){
+                        loss_sum = criterion.fused(hidden, model->head_weight(), gt, vm["loss_chunk"].as<size_t>());
+                    }
+                    else{
+                        loss_sum = criterion.sum(output, gt);
+                    }
+                }
+                loss = loss_sum * loss_scale;
+                if (reducer) reducer->prepare(/*sync_=*/i == micro_batches.size() - 1);
+                {
+                    profiler::scope scope("backward");
+                    loss.backward();
+                }
+                step_loss += loss_sum.detach();
+                useful += (gt != vm["padding"].as<int>()).sum();
+                total_tokens += (double)gt.numel();
+            }
+            if (reducer){
+                profiler::scope scope("reduce");
+                reducer->finalize();
+            }
+            {
+                profiler::scope scope("optimizer");
+                optimizer->step();
+            }
+            micro_iter += micro_batches.size();
+
+            // Memory Report after the First Step (activations are the peak less memory allocated for gradients and states during the step)
+            if (memory_first){
+                process_after = memory::Process_Usage();
+                device_after = memory::Device_Usage(device);
+                memory_items = {
+                    {"parameters", memory::Tensor_Bytes(model->parameters())},
+                    {"buffers", memory::Tensor_Bytes(model->buffers())},
+                    {"gradients", memory::Grad_Bytes(model->parameters())},
+                    {"optimizer states", memory::Optimizer_Bytes(*optimizer)}
+                };
+                activation = device_after.available ? device_after.peak - std::min(device_after.peak, device_before.allocated) : process_after.hwm - std::min(process_after.hwm, process_before.rss);
+                activation -= std::min(activation, memory_items.at(2).second - std::min(memory_items.at(2).second, grad_before));  // gradients allocated in the step
+                activation -= std::min(activation, memory_items.at(3).second - std::min(memory_items.at(3).second, optim_before));  // states allocated in the step
+                memory_items.push_back({std::string("activations (high-water, ") + (device_after.available ? "device" : "RSS") + ")", activation});
+                if (!train_stream){
+                    memory_items.push_back({"dataset tokens", dataset.token_bytes()});
+                    memory_items.push_back({"dataset index", dataset.index_bytes()});
+                }
+                write_memory("after the first step", std::ios::app);
+                memory_first = false;
+            }
+            show_progress->step(/*samples=*/micro_batches.size() * vm["batch_size"].as<size_t>() * world_size, /*tokens=*/count.item<long int>());  // over all processes
+            profiler::Get_Recorder().step();
+            perf::Get_Recorder().step(/*tokens=*/(double)count.item<long int>() / (double)world_size);
 
             // -----------------------------------
-            // c2. Record Loss (iteration)
+            // c2. Record Loss (optimizer step)
             // -----------------------------------
-            show_progress->increment(/*loss_value=*/{loss.item<float>()});
-            ofs << "iters:" << show_progress->get_iters() << '/' << total_iter << ' ' << std::flush;
-            ofs << "ce:" << loss.item<float>() << "(ave:" <<  show_progress->get_ave(0) << ')' << std::endl;
+            pending_loss.push_back(step_loss);
+            pending_info.push_back({micro_iter, step_tokens});
+            iter++;
+            if ((pending_loss.size() >= log_every) || (iter % save_model_iter == 0) || !remaining){
+                flush_loss();
+            }
 
             // -----------------------------------
             // c3. Save Model Weights and Optimizer Parameters
             // -----------------------------------
-            iter = show_progress->get_iters();
-            if (iter % save_model_iter == 0){
-                path = checkpoint_dir + "/models/epoch_latest.pth";  torch::save(model, path);
-                path = checkpoint_dir + "/optims/epoch_latest.pth";  torch::save(optimizer, path);
-                infoo.open(checkpoint_dir + "/models/info.txt", std::ios::out);
-                infoo << "latest = " << epoch - 1 << std::endl;
-                infoo.close();
+            if ((iter % save_model_iter == 0) && remaining){
+                if (pg->is_main()){
+                    ckpt->stage({checkpoint_dir + "/models/epoch_latest.pth"}, model);
+                    ckpt->stage({checkpoint_dir + "/optims/epoch_latest.pth"}, *optimizer);
+                    ckpt->stage_text(checkpoint_dir + "/models/info.txt", "latest = " + std::to_string(epoch - 1) + "\n");
+                }
+                stage_state(epoch, iter, micro_iter, show_progress->get_sum(), std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_start).count());
+                ckpt->commit();
             }
 
         }
@@ -195,28 +535,59 @@ void train(po::variables_map &vm, torch::Device &device, GPT2 &model, std::share
         // -----------------------------------
         // b2. Record Loss (epoch)
         // -----------------------------------
-        train_loss.plot(/*base=*/epoch, /*value=*/show_progress->get_ave());
+        flush_loss();
+        epoch_end = std::chrono::steady_clock::now();
+        if (pg->is_main()) train_loss.plot(/*base=*/epoch, /*value=*/show_progress->get_ave());
         delete show_progress;
+        pg->allreduce(useful);
+        epoch_sec = std::chrono::duration<double>(epoch_end - epoch_start).count();
+        model_gflops = plan_cost.flops_per_token * total_tokens / epoch_sec * 1e-9;  // per process
+        total_tokens *= (double)world_size;
+        useful_tokens = useful.item<double>();
+        ss.str(""); ss.clear(std::stringstream::goodbit);
+        ss << "useful tokens:" << (size_t)useful_tokens << " (" << useful_tokens / total_tokens * 100.0 << "% per batch, ";
+        ss << useful_tokens / epoch_sec << " tokens/s)";
+        std::cout << ss.str() << std::endl;
+        metrics_log->text(train_log, ss.str());
+        ss.str(""); ss.clear(std::stringstream::goodbit);
+        ss << "model FLOPs:" << model_gflops << " GFLOP/s per process";
+        if (peak_gflops > 0.0) ss << " (MFU:" << model_gflops / peak_gflops * 100.0 << "% of " << peak_gflops << " GFLOP/s matmul, ";
+        else ss << " (";
+        ss << "plan:" << plan_cost.flops_per_token * 1e-9 << " GFLOP/token" << (plan_cost.recompute_per_token > 0.0 ? ", recomputation excluded)" : ")");
+        std::cout << ss.str() << std::endl;
+        metrics_log->text(train_log, ss.str());
         
         // -----------------------------------
         // b3. Validation Mode
         // -----------------------------------
-        if (vm["valid"].as<bool>() && ((epoch - 1) % vm["valid_freq"].as<size_t>() == 0)){
-            valid(vm, valid_dataloader, device, criterion, model, epoch, valid_loss);
+        if (vm["valid"].as<bool>() && pg->is_main() && ((epoch - 1) % vm["valid_freq"].as<size_t>() == 0)){
+            valid(vm, valid_dataloader, device, criterion, model, epoch, valid_loss, *metrics_log, valid_log);
         }
 
         // -----------------------------------
         // b4. Save Model Weights and Optimizer Parameters
         // -----------------------------------
-        if (epoch % vm["save_epoch"].as<size_t>() == 0){
-            path = checkpoint_dir + "/models/epoch_" + std::to_string(epoch) + ".pth";  torch::save(model, path);
-            path = checkpoint_dir + "/optims/epoch_" + std::to_string(epoch) + ".pth";  torch::save(optimizer, path);
+        useful.zero_();
+        total_tokens = 0.0;
+        stage_state(epoch + 1, 0, 0, {0.0f}, 0.0);  // the loader has already been rewound for the next epoch
+        if (!pg->is_main()) ckpt->commit();
+        if (pg->is_main()){
+            model_paths = {checkpoint_dir + "/models/epoch_latest.pth"};
+            optim_paths = {checkpoint_dir + "/optims/epoch_latest.pth"};
+            if (epoch % vm["save_epoch"].as<size_t>() == 0){
+                model_paths.push_back(checkpoint_dir + "/models/epoch_" + std::to_string(epoch) + ".pth");
+                optim_paths.push_back(checkpoint_dir + "/optims/epoch_" + std::to_string(epoch) + ".pth");
+            }
+            ckpt->stage(model_paths, model);
+            ckpt->stage(optim_paths, *optimizer);
+            ckpt->stage_text(checkpoint_dir + "/models/info.txt", "latest = " + std::to_string(epoch) + "\n");
+            ckpt->commit();
+            ckpt_stats = ckpt->get_stats();
+            ss.str(""); ss.clear(std::stringstream::goodbit);
+            ss << "checkpoint saves:" << ckpt_stats.saves << " (" << (double)ckpt_stats.bytes / 1e6 << "MB) ";
+            ss << "snapshot:" << ckpt_stats.snapshot_sec << "s stall:" << ckpt_stats.stall_sec << "s write:" << ckpt_stats.write_sec << "s (in background) failures:" << ckpt_stats.failures;
+            metrics_log->text(train_log, ss.str());
         }
-        path = checkpoint_dir + "/models/epoch_latest.pth";  torch::save(model, path);
-        path = checkpoint_dir + "/optims/epoch_latest.pth";  torch::save(optimizer, path);
-        infoo.open(checkpoint_dir + "/models/info.txt", std::ios::out);
-        infoo << "latest = " << epoch << std::endl;
-        infoo.close();
 
         // -----------------------------------
         // b5. Show Elapsed Time
@@ -238,14 +609,19 @@ void train(po::variables_map &vm, torch::Device &device, GPT2 &model, std::share
             // c2. Terminal Output
             // -----------------------------------
             std::cout << date_out << std::endl << progress::separator() << std::endl;
-            ofs << date_out << std::endl << progress::separator() << std::endl;
+            metrics_log->text(train_log, date_out + "\n" + progress::separator());
 
         }
 
     }
 
     // Post Processing
-    ofs.close();
+    profiler::Get_Recorder().close();
+    ckpt->wait();  // wait for checkpoints in flight (and throw if one of them couldn't be written)
+    ckpt.reset();
+    reducer.reset();
+    pg->barrier();
+    metrics_log.reset();  // write records left in the ring
 
     // End Processing
     return;
@@ -1,5 +1,3 @@
-#include <iostream>                    // std::flush
-#include <fstream>                     // std::ofstream
 #include <string>                      // std::string
 #include <tuple>                       // std::tuple
 #include <vector>                      // std::vector
@@ -11,6 +9,7 @@
 #include "networks.hpp"                // GPT2
 #include "dataloader.hpp"              // DataLoader::TextFolder
 #include "visualizer.hpp"              // visualizer::graph
+#include "metrics.hpp"                 // metrics::logger
 
 // Define Namespace
 namespace po = boost::program_options;
@@ -19,14 +18,14 @@ namespace po = boost::program_options;
 // -------------------
 // Validation Function
 // -------------------
-void valid(po::variables_map &vm, DataLoader::TextFolder &valid_dataloader, torch::Device &device, Loss &criterion, GPT2 &model, const size_t epoch, visualizer::graph &writer){
+void valid(po::variables_map &vm, DataLoader::TextFolder &valid_dataloader, torch::Device &device, Loss &criterion, GPT2 &model, const size_t epoch, visualizer::graph &writer, metrics::logger &logger, const size_t valid_log){
 
     // (0) Initialization and Declaration
     size_t iteration;
     float ave_loss, total_loss;
-    std::ofstream ofs;
     std::tuple<torch::Tensor, torch::Tensor> mini_batch;
-    torch::Tensor loss, input, output, gt;
+    std::vector<torch::Tensor> losses;
+    torch::Tensor loss, input, output, gt, values;
 
     // (1) Tensor Forward per Mini Batch
     torch::NoGradGuard no_grad;
@@ -38,18 +37,21 @@ void valid(po::variables_map &vm, DataLoader::TextFolder &valid_dataloader, torc
         gt = std::get<1>(mini_batch).to(device);
         output = model->forward(input);
         loss = criterion(output, gt);
-        total_loss += loss.item<float>();
+        losses.push_back(loss);  // kept on the device until the end of validation
         iteration++;
     }
 
-    // (2) Calculate Average Loss
+    // (2) Calculate Average Loss (summed in the same order as per mini-batch)
+    if (!losses.empty()){
+        values = torch::stack(losses).to(torch::kCPU);
+        for (size_t i = 0; i < losses.size(); i++){
+            total_loss += values.data_ptr<float>()[i];
+        }
+    }
     ave_loss = total_loss / (float)iteration;
 
     // (3.1) Record Loss (Log)
-    ofs.open("checkpoints/" + vm["dataset"].as<std::string>() + "/log/valid.txt", std::ios::app);
-    ofs << "epoch:" << epoch << '/' << vm["epochs"].as<size_t>() << ' ' << std::flush;
-    ofs << "ce:" << ave_loss << std::endl;
-    ofs.close();
+    logger.push(valid_log, {(double)epoch, (double)vm["epochs"].as<size_t>(), ave_loss});
 
     // (3.2) Record Loss (Graph)
     writer.plot(/*base=*/epoch, /*value=*/{ave_loss});
@@ -0,0 +1,151 @@
+#include <vector>
+// For External Library
+#include <torch/torch.h>
+// For Original Header
+#include "arena.hpp"
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> function{Decay_Split}
+// ----------------------------------------------------------
+// {decayed (matrices and embeddings), not decayed (LayerNorm and biases)}
+std::vector<std::vector<torch::Tensor>> arena::Decay_Split(std::vector<torch::Tensor> params){
+    std::vector<std::vector<torch::Tensor>> groups(2);
+    for (auto &param : params){
+        if (param.dim() >= 2) groups.at(0).push_back(param);
+        else groups.at(1).push_back(param);
+    }
+    return groups;
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> constructor
+// ----------------------------------------------------------
+arena::ParamArena::ParamArena(std::vector<std::vector<torch::Tensor>> groups){
+
+    int64_t total, offset;
+    std::vector<int64_t> strides;
+
+    torch::NoGradGuard no_grad;
+    this->group_params = groups;
+    for (auto &group : this->group_params){
+
+        // (1) Allocate Buffers
+        total = 0;
+        for (auto &param : group) total += param.numel();
+        auto opts = group.empty() ? torch::TensorOptions().dtype(torch::kFloat) : group.front().options();
+        this->P.push_back(torch::empty({total}, opts));
+        this->G.push_back(torch::zeros({total}, opts));
+        this->param_views.push_back({});
+        this->grad_views.push_back({});
+
+        // (2) Make Tensors aliasing the Buffers
+        offset = 0;
+        for (auto &param : group){
+            strides = param.contiguous().strides().vec();
+            this->param_views.back().push_back(torch::empty({0}, opts).set_(this->P.back().storage(), offset, param.sizes(), strides));
+            this->grad_views.back().push_back(torch::empty({0}, opts).set_(this->G.back().storage(), offset, param.sizes(), strides));
+            offset += param.numel();
+        }
+
+    }
+
+    // (3) Re-point Parameters and their Gradients into the Buffers
+    this->attach();
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{attach}
+// ----------------------------------------------------------
+// Parameters may be re-pointed by torch::load(), and gradients by zero_grad(set_to_none=true) or autograd.
+// Those are copied back into the buffers once, and point there again.
+void arena::ParamArena::attach(){
+    for (size_t g = 0; g < this->group_params.size(); g++){
+        this->attach(g);
+    }
+    return;
+}
+
+void arena::ParamArena::attach(const size_t g){
+
+    torch::NoGradGuard no_grad;
+    auto &params = this->group_params.at(g);
+
+    for (size_t i = 0; i < params.size(); i++){
+        auto &param_view = this->param_views.at(g).at(i);
+        auto &grad_view = this->grad_views.at(g).at(i);
+        if (params.at(i).data_ptr() != param_view.data_ptr()){
+            param_view.copy_(params.at(i));
+            params.at(i).set_(param_view);
+        }
+        if (!params.at(i).grad().defined()){
+            grad_view.zero_();
+            params.at(i).mutable_grad() = grad_view;
+        }
+        else if (params.at(i).grad().data_ptr() != grad_view.data_ptr()){
+            grad_view.copy_(params.at(i).grad());
+            params.at(i).mutable_grad() = grad_view;
+        }
+    }
+
+    return;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{zero_grad}
+// ----------------------------------------------------------
+void arena::ParamArena::zero_grad(){
+    torch::NoGradGuard no_grad;
+    this->attach();
+    for (auto &grad : this->G){
+        grad.zero_();
+    }
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{groups}
+// ----------------------------------------------------------
+size_t arena::ParamArena::groups(){
+    return this->group_params.size();
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{numel}
+// ----------------------------------------------------------
+size_t arena::ParamArena::numel(){
+    size_t total = 0;
+    for (auto &param : this->P) total += param.numel();
+    return total;
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{params}
+// ----------------------------------------------------------
+torch::Tensor arena::ParamArena::params(const size_t g){
+    return this->P.at(g);
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{grads}
+// ----------------------------------------------------------
+torch::Tensor arena::ParamArena::grads(const size_t g){
+    return this->G.at(g);
+}
+
+
+// ----------------------------------------------------------
+// namespace{arena} -> class{ParamArena} -> function{members}
+// ----------------------------------------------------------
+const std::vector<torch::Tensor> &arena::ParamArena::members(const size_t g){
+    return this->group_params.at(g);
+}
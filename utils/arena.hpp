@@ -0,0 +1,44 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <vector>
+// For External Library
+#include <torch/torch.h>
+
+
+// -----------------------------------
+// namespace{arena}
+// -----------------------------------
+namespace arena{
+
+    // Function Prototype
+    std::vector<std::vector<torch::Tensor>> Decay_Split(std::vector<torch::Tensor> params);
+
+    // -----------------------------------------
+    // namespace{arena} -> class{ParamArena}
+    // -----------------------------------------
+    // Lays out the parameters of each group in one contiguous buffer, and their gradients in another one.
+    // Parameters and gradients are re-pointed into the buffers as aliases (not views, so that they can be detached),
+    // so that whole-model operations are one memory pass per group.
+    class ParamArena{
+    private:
+        std::vector<std::vector<torch::Tensor>> group_params;
+        std::vector<torch::Tensor> P, G;
+        std::vector<std::vector<torch::Tensor>> param_views, grad_views;
+    public:
+        ParamArena(){}
+        ParamArena(std::vector<std::vector<torch::Tensor>> groups);
+        void attach();
+        void attach(const size_t g);
+        void zero_grad();
+        size_t groups();
+        size_t numel();
+        torch::Tensor params(const size_t g);
+        torch::Tensor grads(const size_t g);
+        const std::vector<torch::Tensor> &members(const size_t g);
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,257 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <cstring>
+// For POSIX
+#include <fcntl.h>
+#include <unistd.h>
+// For Original Header
+#include "checkpoint.hpp"
+
+// Define Namespace
+namespace fs = std::filesystem;
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> function{Write_Atomic}
+// ---------------------------------------------------------------
+// The data of '<path>.tmp' is synced before the rename, and the directory after it, so that the file survives also power loss.
+// On failure, '<path>.tmp' is removed, 'path' is left as it was, and false is returned with the reason in 'error'.
+bool checkpoint::Write_Atomic(const std::string &path, const std::string &bytes, std::string &error){
+
+    int fd;
+    size_t done;
+    ssize_t n;
+    std::error_code ec;
+    std::string tmp = path + ".tmp";
+    std::string dir = fs::path(path).parent_path().string();
+
+    // (1) Write and Sync the Temporary File
+    fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0){
+        error = "Couldn't open the file '" + tmp + "' (" + std::strerror(errno) + ").";
+        return false;
+    }
+    for (done = 0; done < bytes.size(); done += n){
+        n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if ((n < 0) && (errno == EINTR)){
+            n = 0;
+            continue;
+        }
+        if (n < 0) break;
+    }
+    if ((done < bytes.size()) || (::fsync(fd) != 0)){
+        error = "Couldn't write the file '" + tmp + "' (" + std::strerror(errno) + ").";
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    ::close(fd);
+
+    // (2) Rename and Sync the Directory
+    fs::rename(tmp, path, ec);
+    if (ec){
+        error = "Couldn't rename the file '" + tmp + "' to '" + path + "' (" + ec.message() + ").";
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0){
+        ::fsync(fd);
+        ::close(fd);
+    }
+
+    return true;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> function{Appender}
+// ---------------------------------------------------------------
+// Writer function of torch::serialize::OutputArchive::save_to() that appends to 'bytes'.
+std::function<size_t(const void*, size_t)> checkpoint::Appender(std::shared_ptr<std::string> bytes){
+    return [bytes](const void *buf, size_t n) -> size_t {
+        bytes->append(static_cast<const char*>(buf), n);
+        return n;
+    };
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> constructor
+// ---------------------------------------------------------------
+checkpoint::writer::writer(const size_t max_inflight_){
+    this->max_inflight = std::max((size_t)1, max_inflight_);
+    this->stopped = false;
+    this->inflight = 0;
+    this->failed = "";
+    this->thread = std::thread(&checkpoint::writer::run, this);
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{stage_archive}
+// ---------------------------------------------------------------
+void checkpoint::writer::stage_archive(const std::vector<std::string> paths, torch::serialize::OutputArchive &archive){
+    auto start = std::chrono::steady_clock::now();
+    auto bytes = std::make_shared<std::string>();
+    archive.save_to(Appender(bytes));
+    for (auto &path : paths){
+        this->staged.push_back({path, bytes});
+    }
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->stats.snapshot_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{stage_text}
+// ---------------------------------------------------------------
+void checkpoint::writer::stage_text(const std::string path, const std::string text){
+    this->staged.push_back({path, std::make_shared<std::string>(text)});
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{commit}
+// ---------------------------------------------------------------
+// Waits only while 'max_inflight' commits are not yet written.
+void checkpoint::writer::commit(){
+
+    std::unique_lock<std::mutex> lock(this->mtx);
+    auto start = std::chrono::steady_clock::now();
+    this->cond.wait(lock, [this]{ return this->inflight < this->max_inflight; });
+    this->stats.stall_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!this->failed.empty()){
+        this->staged.clear();
+        lock.unlock();
+        this->rethrow();
+    }
+
+    for (auto &file : this->staged){
+        this->stats.bytes += file.second->size();
+    }
+    this->stats.saves++;
+    this->queue.push_back(std::move(this->staged));
+    this->staged.clear();
+    this->inflight++;
+    this->cond.notify_all();
+
+    return;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{run}
+// ---------------------------------------------------------------
+void checkpoint::writer::run(){
+
+    bool ok;
+    std::string error;
+    std::vector<std::pair<std::string, std::shared_ptr<std::string>>> files;
+
+    while (true){
+
+        // (1) Wait for Commit
+        {
+            std::unique_lock<std::mutex> lock(this->mtx);
+            this->cond.wait(lock, [this]{ return this->stopped || !this->queue.empty(); });
+            if (this->queue.empty()) return;
+            files = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+
+        // (2) Write Files (stopping at the first failure, so that e.g. 'info.txt' never refers to weights not on disk)
+        auto start = std::chrono::steady_clock::now();
+        ok = true;
+        for (auto &file : files){
+            ok = Write_Atomic(file.first, *file.second, error);
+            if (!ok) break;
+        }
+        files.clear();
+
+        // (3) Release Slot
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->stats.write_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (!ok){
+                std::cerr << "Error : " << error << std::endl;
+                this->stats.failures++;
+                this->stats.error = error;
+                if (this->failed.empty()) this->failed = error;
+            }
+            this->inflight--;
+        }
+        this->cond.notify_all();
+
+    }
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{wait}
+// ---------------------------------------------------------------
+void checkpoint::writer::wait(){
+    {
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->cond.wait(lock, [this]{ return this->inflight == 0; });
+    }
+    this->rethrow();
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{rethrow}
+// ---------------------------------------------------------------
+// Throws a failure of the writer thread once on the calling thread.
+void checkpoint::writer::rethrow(){
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        error.swap(this->failed);
+    }
+    if (!error.empty()) throw std::runtime_error("checkpoint::writer : " + error);
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{get_stats}
+// ---------------------------------------------------------------
+checkpoint::Stats checkpoint::writer::get_stats(){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->stats;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> destructor
+// ---------------------------------------------------------------
+checkpoint::writer::~writer(){
+    {
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->cond.wait(lock, [this]{ return this->inflight == 0; });
+        this->stopped = true;
+    }
+    this->cond.notify_all();
+    if (this->thread.joinable()) this->thread.join();
+}
@@ -0,0 +1,93 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+// For External Library
+#include <torch/torch.h>
+
+
+// -----------------------------------
+// namespace{checkpoint}
+// -----------------------------------
+namespace checkpoint{
+
+    // ------------------------------------------
+    // namespace{checkpoint} -> struct{Stats}
+    // ------------------------------------------
+    struct Stats{
+        size_t saves = 0;
+        size_t bytes = 0;
+        double snapshot_sec = 0.0;  // serialization into memory (training is stopped)
+        double stall_sec = 0.0;  // waiting for a free slot (training is stopped)
+        double write_sec = 0.0;  // writing files in background
+        size_t failures = 0;  // commits stopped at a file that couldn't be written
+        std::string error;  // message of the last failure
+    };
+
+    // Function Prototype
+    bool Write_Atomic(const std::string &path, const std::string &bytes, std::string &error);
+    std::function<size_t(const void*, size_t)> Appender(std::shared_ptr<std::string> bytes);
+
+    // -----------------------------------------
+    // namespace{checkpoint} -> class{writer}
+    // -----------------------------------------
+    // Checkpoints are serialized into memory by stage(), and written by a background thread after commit().
+    // Each file is written to '<path>.tmp', synced and renamed, so that a file is either the previous or the new one.
+    // The files of one commit are written in order (e.g., 'info.txt' after the weights it refers to).
+    // After a failure the rest of the commit is dropped, and the error is thrown by the next commit() or wait().
+    class writer{
+    private:
+        size_t max_inflight;
+        bool stopped;
+        size_t inflight;
+        std::string failed;
+        std::vector<std::pair<std::string, std::shared_ptr<std::string>>> staged;
+        std::deque<std::vector<std::pair<std::string, std::shared_ptr<std::string>>>> queue;
+        Stats stats;
+        std::thread thread;
+        std::mutex mtx;
+        std::condition_variable cond;
+        void run();
+        void rethrow();
+    public:
+        writer(const size_t max_inflight_=2);
+        template <typename T> void stage(const std::vector<std::string> paths, T &obj);
+        void stage_archive(const std::vector<std::string> paths, torch::serialize::OutputArchive &archive);
+        void stage_text(const std::string path, const std::string text);
+        void commit();
+        void wait();
+        Stats get_stats();
+        ~writer();
+    };
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{checkpoint} -> class{writer} -> function{stage}
+// ---------------------------------------------------------------
+template <typename T>
+void checkpoint::writer::stage(const std::vector<std::string> paths, T &obj){
+    auto start = std::chrono::steady_clock::now();
+    auto bytes = std::make_shared<std::string>();
+    torch::save(obj, Appender(bytes));  // serialized straight into the staged buffer (no second copy)
+    for (auto &path : paths){
+        this->staged.push_back({path, bytes});
+    }
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->stats.snapshot_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return;
+}
+
+
+#endif
@@ -1,8 +1,16 @@
+#include <iostream>
 #include <string>
+#include <sstream>
 #include <tuple>
 #include <vector>
+#include <deque>
+#include <utility>
+#include <memory>
 #include <algorithm>
 #include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <cstdlib>
 #include <cmath>
 // For External Library
@@ -25,13 +33,27 @@ DataLoader::TextFolder::TextFolder(datasets::TextFolder &dataset_, const size_t
     this->pin_memory = pin_memory_;
     this->drop_last = drop_last_;
 
-    this->size = this->dataset.size();
-    this->idx = std::vector<size_t>(this->size);
-    for (size_t i = 0; i < this->size; i++){
+    this->total = this->dataset.size();
+    this->idx = std::vector<size_t>(this->total);
+    for (size_t i = 0; i < this->total; i++){
         this->idx.at(i) = i;
     }
 
+    this->rank = 0;
+    this->world_size = 1;
+    this->size = this->total;
     this->count = 0;
+    this->set_count_max();
+
+    this->mt.seed(std::rand());
+
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolder} -> function{set_count_max}
+// --------------------------------------------------------------------------
+void DataLoader::TextFolder::set_count_max(){
     if (this->drop_last){
         this->count_max = std::floor((float)this->size / (float)this->batch_size);
         if ((this->count_max == 0) && (this->size > 0)){
@@ -41,9 +63,7 @@ DataLoader::TextFolder::TextFolder(datasets::TextFolder &dataset_, const size_t
     else{
         this->count_max = std::ceil((float)this->size / (float)this->batch_size);
     }
-
-    this->mt.seed(std::rand());
-
+    return;
 }
 
 
@@ -74,15 +94,14 @@ bool DataLoader::TextFolder::operator()(std::tuple<torch::Tensor, torch::Tensor>
     // (2.1) Get Mini Batch Data using Single Thread
     if (this->num_workers == 0){
         for (i = 0; i < mini_batch_size; i++){
-            this->dataset.get(this->idx.at(idx_start + i), data_before[i]);
+            this->dataset.get(this->idx.at(((idx_start + i) * this->world_size + this->rank) % this->total), data_before[i]);
         }
     }
     // (2.2) Get Mini Batch Data using Multi Thread
     else{
-        omp_set_num_threads(this->num_workers);
-        #pragma omp parallel for
+        #pragma omp parallel for num_threads(this->num_workers)
         for (i = 0; i < mini_batch_size; i++){
-            this->dataset.get(this->idx.at(idx_start + i), data_before[i]);
+            this->dataset.get(this->idx.at(((idx_start + i) * this->world_size + this->rank) % this->total), data_before[i]);
         }
     }
 
@@ -113,6 +132,61 @@ bool DataLoader::TextFolder::operator()(std::tuple<torch::Tensor, torch::Tensor>
 }
 
 
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolder} -> function{shard}
+// --------------------------------------------------------------------------
+// Every process shuffles the whole index in the same way (same seed) and takes every 'world_size_'-th sequence from 'rank_'.
+// The index wraps around so that all processes run the same number of iterations.
+void DataLoader::TextFolder::shard(const size_t rank_, const size_t world_size_){
+    this->rank = rank_;
+    this->world_size = world_size_;
+    this->size = std::ceil((float)this->total / (float)this->world_size);
+    this->count = 0;
+    this->set_count_max();
+    return;
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolder} -> function{save_state}
+// --------------------------------------------------------------------------
+// The shuffled order, the position in the epoch and the random engine, to restart from the next mini-batch.
+void DataLoader::TextFolder::save_state(torch::serialize::OutputArchive &archive){
+    std::stringstream ss;
+    std::vector<int64_t> idx_(this->idx.begin(), this->idx.end());
+    ss << this->mt;
+    archive.write("loader_idx", torch::from_blob(idx_.data(), {(long int)idx_.size()}, torch::kLong).clone());
+    archive.write("loader_count", c10::IValue((int64_t)this->count));
+    archive.write("loader_mt", c10::IValue(ss.str()));
+    return;
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolder} -> function{load_state}
+// --------------------------------------------------------------------------
+void DataLoader::TextFolder::load_state(torch::serialize::InputArchive &archive){
+    torch::Tensor idx_;
+    c10::IValue count_, mt_;
+    std::stringstream ss;
+    archive.read("loader_idx", idx_);
+    archive.read("loader_count", count_);
+    archive.read("loader_mt", mt_);
+    if ((size_t)idx_.numel() != this->total){
+        std::cerr << "Error : The saved order of the training data does not match the dataset." << std::endl;
+        std::exit(1);
+    }
+    idx_ = idx_.to(torch::kLong).contiguous();
+    for (size_t i = 0; i < this->total; i++){
+        this->idx.at(i) = idx_.data_ptr<int64_t>()[i];
+    }
+    this->count = count_.toInt();
+    ss << mt_.toStringRef();
+    ss >> this->mt;
+    return;
+}
+
+
 // --------------------------------------------------------------------------
 // namespace{DataLoader} -> class{TextFolder} -> function{reset}
 // --------------------------------------------------------------------------
@@ -130,6 +204,383 @@ size_t DataLoader::TextFolder::get_count_max(){
 }
 
 
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> constructor
+// --------------------------------------------------------------------
+DataLoader::TextFolderRandom::TextFolderRandom(datasets::TextFolder &dataset_, const size_t batch_size_, const size_t tokens_per_epoch, const size_t num_workers_, const bool pin_memory_){
+
+    this->dataset = dataset_;
+    this->batch_size = batch_size_;
+    this->num_workers = num_workers_;
+    this->pin_memory = pin_memory_;
+
+    // Only the cumulative number of tokens per document is kept, instead of the index of every sequence
+    this->tokens_sum = std::vector<long int>(this->dataset.documents() + 1, 0);
+    for (size_t i = 0; i < this->dataset.documents(); i++){
+        this->tokens_sum.at(i + 1) = this->tokens_sum.at(i) + this->dataset.tokens(i);
+    }
+
+    this->count = 0;
+    this->count_max = std::ceil((float)tokens_per_epoch / (float)(this->batch_size * this->dataset.get_sequence()));
+    if (this->tokens_sum.back() == 0) this->count_max = 0;
+
+    this->mt.seed(std::rand());
+
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> operator
+// --------------------------------------------------------------------
+bool DataLoader::TextFolderRandom::operator()(std::tuple<torch::Tensor, torch::Tensor> &data){
+
+    // (0) Initialization and Declaration
+    size_t i;
+    long int r;
+    std::pair<long int, long int> windows;
+    std::vector<size_t> docs(this->batch_size);
+    std::vector<long int> offsets(this->batch_size);
+    std::vector<torch::Tensor> data1(this->batch_size), data2(this->batch_size);
+    std::tuple<torch::Tensor, torch::Tensor> *data_before;
+    std::uniform_int_distribution<long int> dist;
+
+    // (1) Special Handling on Certain Count
+    if (this->count == this->count_max){
+        this->count = 0;
+        return false;
+    }
+
+    // (2) Draw Documents weighted by their Tokens (without padding), and Offsets uniformly over the Windows of the Document
+    dist = std::uniform_int_distribution<long int>(0, this->tokens_sum.back() - 1);
+    for (i = 0; i < this->batch_size; i++){
+        r = dist(this->mt);
+        docs.at(i) = std::upper_bound(this->tokens_sum.begin(), this->tokens_sum.end(), r) - this->tokens_sum.begin() - 1;
+        windows = this->dataset.windows(docs.at(i));
+        offsets.at(i) = windows.first + std::uniform_int_distribution<long int>(0, windows.second - 1)(this->mt);
+    }
+
+    // (3) Get Mini Batch Data
+    data_before = new std::tuple<torch::Tensor, torch::Tensor>[this->batch_size];
+    // (3.1) Get Mini Batch Data using Single Thread
+    if (this->num_workers == 0){
+        for (i = 0; i < this->batch_size; i++){
+            this->dataset.get(docs.at(i), offsets.at(i), data_before[i]);
+        }
+    }
+    // (3.2) Get Mini Batch Data using Multi Thread
+    else{
+        #pragma omp parallel for num_threads(this->num_workers)
+        for (i = 0; i < this->batch_size; i++){
+            this->dataset.get(docs.at(i), offsets.at(i), data_before[i]);
+        }
+    }
+
+    // (4) Organize Data
+    for (i = 0; i < this->batch_size; i++){
+        data1.at(i) = std::get<0>(data_before[i]);
+        data2.at(i) = std::get<1>(data_before[i]);
+    }
+    torch::Tensor input = torch::stack(data1, /*dim=*/0);  // {N,D}
+    torch::Tensor target = torch::stack(data2, /*dim=*/0);  // {N,D}
+
+    // (5) Pin
+    if (this->pin_memory){
+        input = input.pin_memory();
+        target = target.pin_memory();
+    }
+
+    // Post Processing
+    this->count++;
+    data = {input, target};
+    delete[] data_before;
+
+    // End Processing
+    return true;
+
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> function{shard}
+// --------------------------------------------------------------------------
+// Each process draws its own offsets and the token budget per epoch is divided between processes.
+void DataLoader::TextFolderRandom::shard(const size_t rank, const size_t world_size){
+    this->mt.seed(this->mt() + rank);
+    this->count = 0;
+    this->count_max = std::ceil((float)this->count_max / (float)world_size);
+    return;
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> function{save_state}
+// --------------------------------------------------------------------------
+void DataLoader::TextFolderRandom::save_state(torch::serialize::OutputArchive &archive){
+    std::stringstream ss;
+    ss << this->mt;
+    archive.write("loader_count", c10::IValue((int64_t)this->count));
+    archive.write("loader_mt", c10::IValue(ss.str()));
+    return;
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> function{load_state}
+// --------------------------------------------------------------------------
+void DataLoader::TextFolderRandom::load_state(torch::serialize::InputArchive &archive){
+    c10::IValue count_, mt_;
+    std::stringstream ss;
+    archive.read("loader_count", count_);
+    archive.read("loader_mt", mt_);
+    this->count = count_.toInt();
+    ss << mt_.toStringRef();
+    ss >> this->mt;
+    return;
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> function{reset}
+// --------------------------------------------------------------------------
+void DataLoader::TextFolderRandom::reset(){
+    this->count = 0;
+    return;
+}
+
+
+// ---------------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextFolderRandom} -> function{get_count_max}
+// ---------------------------------------------------------------------------------
+size_t DataLoader::TextFolderRandom::get_count_max(){
+    return this->count_max;
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextShardReader} -> constructor
+// --------------------------------------------------------------------
+DataLoader::TextShardReader::TextShardReader(datasets::TextShards &dataset_, const size_t prefetch_){
+    this->dataset = dataset_;
+    this->prefetch = std::max((size_t)1, prefetch_);
+    this->finished = true;
+    this->stopped = true;
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextShardReader} -> function{run}
+// --------------------------------------------------------------------
+void DataLoader::TextShardReader::run(const std::vector<size_t> order){
+
+    for (auto &s : order){
+
+        // (1) Wait for Space of Read-Ahead Queue
+        {
+            std::unique_lock<std::mutex> lock(this->mtx);
+            this->cond.wait(lock, [this]{ return this->stopped || (this->queue.size() < this->prefetch); });
+            if (this->stopped) return;
+        }
+
+        // (2) Load Shard out of Lock
+        std::shared_ptr<datasets::TextShard> shard = std::make_shared<datasets::TextShard>();
+        this->dataset.load(s, *shard);
+
+        // (3) Push Shard
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->queue.push_back(shard);
+        }
+        this->cond.notify_all();
+
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->finished = true;
+    }
+    this->cond.notify_all();
+
+    return;
+
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextShardReader} -> function{start}
+// --------------------------------------------------------------------
+void DataLoader::TextShardReader::start(const std::vector<size_t> &order){
+    this->stop();
+    this->queue.clear();
+    this->finished = false;
+    this->stopped = false;
+    this->thread = std::thread(&DataLoader::TextShardReader::run, this, order);
+    return;
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextShardReader} -> function{pop}
+// --------------------------------------------------------------------
+bool DataLoader::TextShardReader::pop(std::shared_ptr<datasets::TextShard> &shard){
+    {
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->cond.wait(lock, [this]{ return this->finished || this->stopped || !this->queue.empty(); });
+        if (this->queue.empty()) return false;
+        shard = this->queue.front();
+        this->queue.pop_front();
+    }
+    this->cond.notify_all();
+    return true;
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextShardReader} -> function{stop}
+// --------------------------------------------------------------------
+void DataLoader::TextShardReader::stop(){
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->stopped = true;
+    }
+    this->cond.notify_all();
+    if (this->thread.joinable()) this->thread.join();
+    return;
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextShardReader} -> destructor
+// --------------------------------------------------------------------
+DataLoader::TextShardReader::~TextShardReader(){
+    this->stop();
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextStream} -> constructor
+// --------------------------------------------------------------------
+DataLoader::TextStream::TextStream(datasets::TextShards &dataset_, const size_t batch_size_, const bool shuffle_, const size_t buffer_size_, const size_t prefetch_){
+
+    this->dataset = dataset_;
+    this->batch_size = batch_size_;
+    this->shuffle = shuffle_;
+    this->buffer_size = std::max((size_t)1, buffer_size_);
+    this->reader = std::make_shared<DataLoader::TextShardReader>(this->dataset, prefetch_);
+    this->current = nullptr;
+    this->current_pos = 0;
+
+    this->size = this->dataset.size();
+    this->count = 0;
+    this->count_max = std::ceil((float)this->size / (float)this->batch_size);
+
+    this->mt.seed(std::rand());
+
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextStream} -> function{fill}
+// --------------------------------------------------------------------
+void DataLoader::TextStream::fill(){
+    std::tuple<torch::Tensor, torch::Tensor> window;
+    while (this->buffer.size() < this->buffer_size){
+        if ((this->current == nullptr) || (this->current_pos == this->current->size())){
+            if (!this->reader->pop(this->current)){
+                this->current = nullptr;
+                this->current_order.clear();
+                return;
+            }
+            if (this->shuffle){
+                this->current_order = std::vector<size_t>(this->current->size());
+                for (size_t i = 0; i < this->current_order.size(); i++) this->current_order.at(i) = i;
+                std::shuffle(this->current_order.begin(), this->current_order.end(), this->mt);
+            }
+            this->current_pos = 0;
+        }
+        this->dataset.get(*this->current, (this->shuffle ? this->current_order.at(this->current_pos) : this->current_pos), window);
+        this->buffer.push_back(std::move(window));
+        this->current_pos++;
+    }
+    return;
+}
+
+
+// --------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextStream} -> operator
+// --------------------------------------------------------------------
+bool DataLoader::TextStream::operator()(std::tuple<torch::Tensor, torch::Tensor> &data){
+
+    // (0) Initialization and Declaration
+    size_t i, pick;
+    size_t idx_start = this->batch_size * this->count;
+    size_t idx_end = std::min(this->size, (idx_start + this->batch_size));
+    size_t mini_batch_size = idx_end - idx_start;
+    std::vector<size_t> order;
+    std::vector<torch::Tensor> data1, data2;
+    std::tuple<torch::Tensor, torch::Tensor> window;
+
+    // (1) Special Handling on Certain Count
+    if (this->count == this->count_max){
+        this->reset();
+        return false;
+    }
+    else if (this->count == 0){
+        order = std::vector<size_t>(this->dataset.shards());
+        for (i = 0; i < order.size(); i++) order.at(i) = i;
+        if (this->shuffle) std::shuffle(order.begin(), order.end(), this->mt);
+        this->reader->start(order);
+    }
+
+    // (2) Get Mini Batch Data from Shuffle Buffer
+    for (i = 0; i < mini_batch_size; i++){
+        this->fill();
+        if (this->buffer.empty()) break;
+        if (this->shuffle){
+            pick = std::uniform_int_distribution<size_t>(0, this->buffer.size() - 1)(this->mt);
+            std::swap(this->buffer.at(pick), this->buffer.back());
+            window = std::move(this->buffer.back());
+            this->buffer.pop_back();
+        }
+        else{
+            window = std::move(this->buffer.front());
+            this->buffer.pop_front();
+        }
+        data1.push_back(std::get<0>(window));
+        data2.push_back(std::get<1>(window));
+    }
+
+    // Post Processing
+    this->count++;
+    data = {torch::stack(data1, /*dim=*/0), torch::stack(data2, /*dim=*/0)};  // {N,D}, {N,D}
+
+    // End Processing
+    return true;
+
+}
+
+
+// --------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextStream} -> function{reset}
+// --------------------------------------------------------------------------
+void DataLoader::TextStream::reset(){
+    this->reader->stop();
+    this->buffer.clear();
+    this->current = nullptr;
+    this->current_order.clear();
+    this->current_pos = 0;
+    this->count = 0;
+    return;
+}
+
+
+// ---------------------------------------------------------------------------------
+// namespace{DataLoader} -> class{TextStream} -> function{get_count_max}
+// ---------------------------------------------------------------------------------
+size_t DataLoader::TextStream::get_count_max(){
+    return this->count_max;
+}
+
+
 // --------------------------------------------------------------------
 // namespace{DataLoader} -> class{TextFolderPredictWithPaths} -> constructor
 // --------------------------------------------------------------------
@@ -197,8 +648,7 @@ bool DataLoader::TextFolderPredictWithPaths::operator()(std::tuple<torch::Tensor
     }
     // (2.2) Get Mini Batch Data using Multi Thread
     else{
-        omp_set_num_threads(this->num_workers);
-        #pragma omp parallel for
+        #pragma omp parallel for num_threads(this->num_workers)
         for (i = 0; i < mini_batch_size; i++){
             this->dataset.get(this->idx.at(idx_start + i), data_before[i]);
         }
@@ -4,7 +4,13 @@
 #include <string>
 #include <tuple>
 #include <vector>
+#include <deque>
+#include <utility>
+#include <memory>
 #include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 // For External Library
 #include <torch/torch.h>
 // For Original Header
@@ -27,19 +33,96 @@ namespace DataLoader{
         size_t num_workers;
         bool pin_memory;
         bool drop_last;
-        size_t size;
+        size_t size, total;
+        size_t rank, world_size;
         std::vector<size_t> idx;
         size_t count;
         size_t count_max;
         std::mt19937 mt;
+        void set_count_max();
     public:
         TextFolder(){}
         TextFolder(datasets::TextFolder &dataset_, const size_t batch_size_=1, const bool shuffle_=false, const size_t num_workers_=0, const bool pin_memory_=false, const bool drop_last_=false);
         bool operator()(std::tuple<torch::Tensor, torch::Tensor> &data);
+        void shard(const size_t rank_, const size_t world_size_);
+        void save_state(torch::serialize::OutputArchive &archive);
+        void load_state(torch::serialize::InputArchive &archive);
         void reset();
         size_t get_count_max();
     };
     
+    // -----------------------------------------------------
+    // namespace{DataLoader} -> class{TextFolderRandom}
+    // -----------------------------------------------------
+    class TextFolderRandom{
+    private:
+        datasets::TextFolder dataset;
+        size_t batch_size;
+        size_t num_workers;
+        bool pin_memory;
+        std::vector<long int> tokens_sum;
+        size_t count;
+        size_t count_max;
+        std::mt19937 mt;
+    public:
+        TextFolderRandom(){}
+        TextFolderRandom(datasets::TextFolder &dataset_, const size_t batch_size_=1, const size_t tokens_per_epoch=0, const size_t num_workers_=0, const bool pin_memory_=false);
+        bool operator()(std::tuple<torch::Tensor, torch::Tensor> &data);
+        void shard(const size_t rank, const size_t world_size);
+        void save_state(torch::serialize::OutputArchive &archive);
+        void load_state(torch::serialize::InputArchive &archive);
+        void reset();
+        size_t get_count_max();
+    };
+
+    // -----------------------------------------------------
+    // namespace{DataLoader} -> class{TextShardReader}
+    // -----------------------------------------------------
+    class TextShardReader{
+    private:
+        datasets::TextShards dataset;
+        size_t prefetch;
+        bool finished, stopped;
+        std::deque<std::shared_ptr<datasets::TextShard>> queue;
+        std::thread thread;
+        std::mutex mtx;
+        std::condition_variable cond;
+        void run(const std::vector<size_t> order);
+    public:
+        TextShardReader(datasets::TextShards &dataset_, const size_t prefetch_);
+        void start(const std::vector<size_t> &order);
+        bool pop(std::shared_ptr<datasets::TextShard> &shard);
+        void stop();
+        ~TextShardReader();
+    };
+
+    // -----------------------------------------------------
+    // namespace{DataLoader} -> class{TextStream}
+    // -----------------------------------------------------
+    class TextStream{
+    private:
+        datasets::TextShards dataset;
+        size_t batch_size;
+        bool shuffle;
+        size_t buffer_size;
+        size_t size;
+        size_t count;
+        size_t count_max;
+        std::mt19937 mt;
+        std::shared_ptr<TextShardReader> reader;
+        std::shared_ptr<datasets::TextShard> current;
+        std::vector<size_t> current_order;
+        size_t current_pos;
+        std::deque<std::tuple<torch::Tensor, torch::Tensor>> buffer;  // copied windows, so that only the current shard stays alive
+        void fill();
+    public:
+        TextStream(){}
+        TextStream(datasets::TextShards &dataset_, const size_t batch_size_=1, const bool shuffle_=false, const size_t buffer_size_=8192, const size_t prefetch_=2);
+        bool operator()(std::tuple<torch::Tensor, torch::Tensor> &data);
+        void reset();
+        size_t get_count_max();
+    };
+
     // -----------------------------------------------------
     // namespace{DataLoader} -> class{TextFolderPredictWithPaths}
     // -----------------------------------------------------
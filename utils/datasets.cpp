@@ -1,3 +1,4 @@
+#include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <string>
@@ -6,11 +7,14 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
 // For External Library
 #include <torch/torch.h>
 #include <tokenizers_cpp.h>
+#include <omp.h>
 // For Original Header
 #include "datasets.hpp"
 
@@ -61,34 +65,86 @@ void datasets::collect(const std::string root, const std::string sub, std::vecto
 
 
 // -----------------------------------------------
-// namespace{datasets} -> function{Text_Loader}
+// namespace{datasets} -> function{Text_Read}
 // -----------------------------------------------
-torch::Tensor datasets::Text_Loader(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence, const int &endoftext, const int &padding){
+std::string datasets::Text_Read(const std::string &path){
 
     std::ifstream ifs;
     std::istreambuf_iterator<char> it, last;
     std::string str;
-    std::vector<int> ids_int;
-    std::vector<int64_t> ids;
-    torch::Tensor data;
 
-    // Get Data
     ifs.open(path);
     it = std::istreambuf_iterator<char>(ifs);
     str = std::string(it, last);
     if (!str.empty() && str.back() == '\n') str.pop_back();
-    ids_int = tokenizer->Encode(str);
-    
-    ids_int.push_back(endoftext);
-    ids_int.insert(ids_int.begin(), sequence - 1, padding);
-    ids_int.insert(ids_int.end(), sequence - 1, padding);
-    
-    ids = std::vector<int64_t>(ids_int.size());
-    for (size_t i = 0; i < ids_int.size(); i++) ids.at(i) = ids_int.at(i);
     ifs.close();
 
-    // Get Tensor
-    data = torch::from_blob(ids.data(), {(long int)ids.size()}, torch::kLong).clone();
+    return str;
+
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Text_Encode}
+// -----------------------------------------------
+std::vector<std::vector<int>> datasets::Text_Encode(const std::vector<std::string> &paths, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const size_t num_workers, LoadStats &stats){
+
+    size_t i;
+    std::vector<std::string> strs(paths.size());
+    std::vector<std::vector<int>> ids;
+
+    // (1.1) Read Files using Single Thread
+    if (num_workers == 0){
+        for (i = 0; i < paths.size(); i++){
+            strs.at(i) = datasets::Text_Read(paths.at(i));
+        }
+    }
+    // (1.2) Read Files using Multi Thread
+    else{
+        #pragma omp parallel for num_threads(num_workers)  // not omp_set_num_threads(), which would also change the intra-op threads of LibTorch
+        for (i = 0; i < paths.size(); i++){
+            strs.at(i) = datasets::Text_Read(paths.at(i));
+        }
+    }
+
+    // (2.1) Tokenize Files one by one
+    if (num_workers == 0){
+        ids = std::vector<std::vector<int>>(strs.size());
+        for (i = 0; i < strs.size(); i++){
+            ids.at(i) = tokenizer->Encode(strs.at(i));
+        }
+    }
+    // (2.2) Tokenize Files using Batch Encoding (parallelized inside the tokenizer)
+    else{
+        ids = tokenizer->EncodeBatch(strs);
+    }
+
+    // (3) Update Statistics
+    stats.files += paths.size();
+    for (i = 0; i < strs.size(); i++){
+        stats.bytes += strs.at(i).size();
+        stats.tokens += ids.at(i).size();
+    }
+
+    return ids;
+
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Text_Pack}
+// -----------------------------------------------
+torch::Tensor datasets::Text_Pack(const std::vector<int> &ids, const long int &sequence, const int &endoftext, const int &padding){
+
+    size_t i;
+    int64_t *ptr;
+    torch::Tensor data;
+
+    // {padding * (sequence - 1), ids, endoftext, padding * (sequence - 1)}
+    data = torch::full({(long int)ids.size() + 1 + 2 * (sequence - 1)}, padding, torch::kLong);
+    ptr = data.data_ptr<int64_t>() + (sequence - 1);
+    for (i = 0; i < ids.size(); i++) ptr[i] = ids.at(i);
+    ptr[ids.size()] = endoftext;
 
     return data;
 
@@ -98,24 +154,139 @@ torch::Tensor datasets::Text_Loader(const std::string &path, const std::shared_p
 // -----------------------------------------------
 // namespace{datasets} -> function{Text_Loader}
 // -----------------------------------------------
-torch::Tensor datasets::Text_Loader_Predict(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer){
+torch::Tensor datasets::Text_Loader(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence, const int &endoftext, const int &padding){
+    std::vector<int> ids = tokenizer->Encode(datasets::Text_Read(path));
+    return datasets::Text_Pack(ids, sequence, endoftext, padding);
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Text_Boundary}
+// -----------------------------------------------
+// Returns the last position where the text can be cut without changing the tokens, or 0 if there is none.
+// With a byte-level BPE tokenizer whose pre-tokenizer is the GPT-2 regex (without prefix space),
+// a pre-token never crosses the end of a single '\n' or the start of a single ' ' that lies between
+// two non-whitespace characters, so encoding the two parts separately gives the same ids as the whole.
+// Runs of whitespace and "\r\n" are never cut, because the regex merges them differently at the end of a string.
+size_t datasets::Text_Boundary(const std::string &str){
+
+    size_t i;
+    auto is_space = [](const char c){ return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\v') || (c == '\f'); };
+
+    // (1) Cut after a single newline
+    for (i = str.size() - 1; i >= 2; i--){
+        if ((str[i - 1] == '\n') && !is_space(str[i - 2]) && !is_space(str[i])) return i;
+    }
+
+    // (2) Cut before a single space
+    for (i = str.size() - 2; i >= 1; i--){
+        if ((str[i] == ' ') && !is_space(str[i - 1]) && !is_space(str[i + 1])) return i;
+    }
+
+    return 0;
+
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Text_Loader_Stream}
+// -----------------------------------------------
+// Tokenizes a large file chunk by chunk, keeps the ids of each chunk as they are, and copies them once into an exactly-sized tensor.
+// Besides the result, the memory is the int32 ids of the chunks (half of the result) and (num_workers + 1) chunks of text.
+// The ids are identical to those of Text_Loader under the conditions of Text_Boundary;
+// tokenizers that add special tokens per call or put a prefix space before every input diverge at each chunk.
+torch::Tensor datasets::Text_Loader_Stream(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence, const int &endoftext, const int &padding, const size_t num_workers, LoadStats &stats){
 
+    size_t i, cut;
+    size_t n_tokens;
+    size_t chunks_per_batch;
+    bool eof;
     std::ifstream ifs;
-    std::istreambuf_iterator<char> it, last;
-    std::string str;
+    std::string buff;
+    std::vector<std::string> chunks;
+    std::vector<std::vector<int>> chunk_ids, ids;
+    int64_t *ptr;
+    torch::Tensor data;
+
+    // (1) Prepare Buffer
+    ifs.open(path, std::ios::in | std::ios::binary);
+    n_tokens = 0;
+    chunks_per_batch = std::max((size_t)1, num_workers);
+
+    // (2) Tokenize per Chunk
+    eof = false;
+    while (!eof){
+
+        // (2.1) Read Chunks
+        while ((chunks.size() < chunks_per_batch) && !eof){
+            size_t prev = buff.size();
+            buff.resize(prev + datasets::chunk_bytes);
+            ifs.read(buff.data() + prev, datasets::chunk_bytes);
+            buff.resize(prev + ifs.gcount());
+            eof = ifs.eof() || (ifs.gcount() == 0);
+            if (eof){
+                if (!buff.empty() && buff.back() == '\n') buff.pop_back();
+                chunks.push_back(std::move(buff));
+                buff = std::string();
+            }
+            else if ((buff.size() >= 3) && ((cut = datasets::Text_Boundary(buff)) > 0)){
+                chunks.push_back(buff.substr(0, cut));
+                buff.erase(0, cut);
+            }
+        }
+
+        // (2.2) Encode Chunks
+        if (num_workers == 0){
+            chunk_ids = std::vector<std::vector<int>>(chunks.size());
+            for (i = 0; i < chunks.size(); i++) chunk_ids.at(i) = tokenizer->Encode(chunks.at(i));
+        }
+        else{
+            chunk_ids = tokenizer->EncodeBatch(chunks);
+        }
+
+        // (2.3) Keep Ids
+        for (i = 0; i < chunks.size(); i++){
+            stats.bytes += chunks.at(i).size();
+            stats.tokens += chunk_ids.at(i).size();
+            n_tokens += chunk_ids.at(i).size();
+            ids.push_back(std::move(chunk_ids.at(i)));
+        }
+        chunks.clear();
+        chunk_ids.clear();
+
+    }
+    ifs.close();
+    stats.files++;
+
+    // (3) Get Tensor : {padding * (sequence - 1), ids, <|endoftext|>, padding * (sequence - 1)}
+    data = torch::empty({(long int)n_tokens + 2 * sequence - 1}, torch::kLong);
+    ptr = data.data_ptr<int64_t>();
+    ptr = std::fill_n(ptr, sequence - 1, (int64_t)padding);
+    for (auto &piece : ids){
+        ptr = std::copy(piece.begin(), piece.end(), ptr);
+        std::vector<int>().swap(piece);  // released as soon as it is copied
+    }
+    *ptr++ = endoftext;
+    std::fill_n(ptr, sequence - 1, (int64_t)padding);
+
+    return data;
+
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Text_Loader_Predict}
+// -----------------------------------------------
+torch::Tensor datasets::Text_Loader_Predict(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer){
+
     std::vector<int> ids_int;
     std::vector<int64_t> ids;
     torch::Tensor data;
 
     // Get Data
-    ifs.open(path);
-    it = std::istreambuf_iterator<char>(ifs);
-    str = std::string(it, last);
-    if (!str.empty() && str.back() == '\n') str.pop_back();
-    ids_int = tokenizer->Encode(str);
+    ids_int = tokenizer->Encode(datasets::Text_Read(path));
     ids = std::vector<int64_t>(ids_int.size());
     for (size_t i = 0; i < ids_int.size(); i++) ids.at(i) = ids_int.at(i);
-    ifs.close();
 
     // Get Tensor
     data = torch::from_blob(ids.data(), {(long int)ids.size()}, torch::kLong).clone();
@@ -125,22 +296,245 @@ torch::Tensor datasets::Text_Loader_Predict(const std::string &path, const std::
 }
 
 
+// -----------------------------------------------
+// namespace{datasets} -> function{Shard_Write}
+// -----------------------------------------------
+// Shard format (host byte order) : "GPT2SHRD", uint64 {the number of documents}, uint64 {length of each document}, int32 {tokens of all documents}
+// The documents are stored without <|endoftext|> and padding, which are added when they are loaded.
+void datasets::Shard_Write(const std::string &path, const std::vector<std::vector<int>> &docs){
+
+    uint64_t n_docs, length;
+    std::string tmp_path;
+    std::ofstream ofs;
+
+    tmp_path = path + ".tmp";
+    ofs.open(tmp_path, std::ios::out | std::ios::binary);
+    ofs.write("GPT2SHRD", 8);
+    n_docs = docs.size();
+    ofs.write((const char*)&n_docs, sizeof(uint64_t));
+    for (auto &doc : docs){
+        length = doc.size();
+        ofs.write((const char*)&length, sizeof(uint64_t));
+    }
+    for (auto &doc : docs){
+        ofs.write((const char*)doc.data(), doc.size() * sizeof(int32_t));
+    }
+    ofs.close();
+    fs::rename(tmp_path, path);
+
+    return;
+
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Shard_Read_Header}
+// -----------------------------------------------
+void datasets::Shard_Read_Header(const std::string &path, std::ifstream &ifs, std::vector<uint64_t> &lengths){
+
+    char magic[8];
+    uint64_t n_docs;
+
+    ifs.open(path, std::ios::in | std::ios::binary);
+    ifs.read(magic, 8);
+    if (ifs.fail() || (std::string(magic, 8) != "GPT2SHRD")){
+        std::cerr << "Error : " << path << " is not a shard of tokens." << std::endl;
+        std::exit(1);
+    }
+    ifs.read((char*)&n_docs, sizeof(uint64_t));
+    lengths = std::vector<uint64_t>(n_docs);
+    ifs.read((char*)lengths.data(), n_docs * sizeof(uint64_t));
+
+    return;
+
+}
+
+
+// -----------------------------------------------
+// namespace{datasets} -> function{Shard_Writer}
+// -----------------------------------------------
+void datasets::Shard_Writer(const std::string &root, const std::string &shard_root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const size_t shard_tokens, const size_t num_workers){
+
+    size_t i, group;
+    size_t n_shards, n_tokens;
+    char fname[32];
+    std::vector<std::string> paths, group_paths;
+    std::vector<std::vector<int>> ids, docs;
+    torch::Tensor text;
+    LoadStats stats;
+
+    // (1) Collect Files
+    datasets::collect(root, paths);
+    std::sort(paths.begin(), paths.end());
+    fs::create_directories(shard_root);
+    group = std::max((size_t)1, num_workers) * datasets::files_per_worker;
+
+    // (2) Define Processing to Store Documents
+    n_shards = 0;
+    n_tokens = 0;
+    auto write_shard = [&](){
+        std::snprintf(fname, sizeof(fname), "shard_%06zu.bin", n_shards);
+        datasets::Shard_Write(shard_root + '/' + fname, docs);
+        docs.clear();
+        n_shards++;
+        n_tokens = 0;
+    };
+    auto push_docs = [&](std::vector<std::vector<int>> &new_docs){
+        for (auto &doc : new_docs){
+            n_tokens += doc.size();
+            docs.push_back(std::move(doc));
+            if (n_tokens >= shard_tokens) write_shard();
+        }
+        new_docs.clear();
+    };
+    auto encode_group = [&](){
+        if (group_paths.empty()) return;
+        ids = datasets::Text_Encode(group_paths, tokenizer, num_workers, stats);
+        push_docs(ids);
+        group_paths.clear();
+    };
+
+    // (3) Tokenize Files in the Order of Sorted Paths
+    for (i = 0; i < paths.size(); i++){
+        if (fs::file_size(paths.at(i)) > datasets::chunk_bytes){
+            encode_group();
+            text = datasets::Text_Loader_Stream(paths.at(i), tokenizer, /*sequence=*/1, /*endoftext=*/0, /*padding=*/0, num_workers, stats);
+            ids = std::vector<std::vector<int>>(1, std::vector<int>(text.data_ptr<int64_t>(), text.data_ptr<int64_t>() + text.numel() - 1));
+            text = torch::Tensor();
+            push_docs(ids);
+        }
+        else{
+            group_paths.push_back(paths.at(i));
+            if (group_paths.size() == group) encode_group();
+        }
+    }
+    encode_group();
+    if (!docs.empty()) write_shard();
+
+    std::cout << "shards : " << n_shards << " (files:" << stats.files << ", tokens:" << stats.tokens << ")" << std::endl;
+
+    return;
+
+}
+
+
 // -------------------------------------------------------------------------
 // namespace{datasets} -> class{TextFolder} -> constructor
 // -------------------------------------------------------------------------
-datasets::TextFolder::TextFolder(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence_, const long int &stride, const int &endoftext, const int &padding){
-    std::vector<std::string> paths;
+datasets::TextFolder::TextFolder(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence_, const long int &stride, const int &endoftext, const int &padding, const size_t num_workers, const bool packing, const bool indexing){
+
+    size_t i, k;
+    size_t group, start, end;
+    long int pad_sequence;
+    std::vector<std::string> paths, group_paths;
+    std::vector<size_t> group_idx;
+    std::vector<std::vector<int>> ids;
+    std::chrono::steady_clock::time_point time_start, time_end;
+
+    // (1) Collect Files
+    time_start = std::chrono::steady_clock::now();
     datasets::collect(root, paths);
     std::sort(paths.begin(), paths.end());
     this->sequence = sequence_;
-    for (size_t i = 0; i < paths.size(); i++){
-        torch::Tensor text = datasets::Text_Loader(paths.at(i), tokenizer, this->sequence, endoftext, padding);
-        this->texts.push_back(text);
-        for (long int j = 0; j < text.numel() - this->sequence; j += stride){
+    this->texts = std::vector<torch::Tensor>(paths.size());
+    pad_sequence = packing ? 1 : this->sequence;  // documents are not padded in packing
+
+    // (2) Tokenize Large Files as Streams of Chunks
+    for (i = 0; i < paths.size(); i++){
+        if (fs::file_size(paths.at(i)) > datasets::chunk_bytes){
+            this->texts.at(i) = datasets::Text_Loader_Stream(paths.at(i), tokenizer, pad_sequence, endoftext, padding, num_workers, this->stats);
+        }
+        else{
+            group_idx.push_back(i);
+        }
+    }
+
+    // (3) Tokenize the Other Files per Group
+    group = std::max((size_t)1, num_workers) * datasets::files_per_worker;
+    for (start = 0; start < group_idx.size(); start += group){
+        end = std::min(group_idx.size(), start + group);
+        group_paths.clear();
+        for (k = start; k < end; k++) group_paths.push_back(paths.at(group_idx.at(k)));
+        ids = datasets::Text_Encode(group_paths, tokenizer, num_workers, this->stats);
+        if (num_workers == 0){
+            for (k = 0; k < ids.size(); k++){
+                this->texts.at(group_idx.at(start + k)) = datasets::Text_Pack(ids.at(k), pad_sequence, endoftext, padding);
+            }
+        }
+        else{
+            #pragma omp parallel for num_threads(num_workers)
+            for (k = 0; k < ids.size(); k++){
+                this->texts.at(group_idx.at(start + k)) = datasets::Text_Pack(ids.at(k), pad_sequence, endoftext, padding);
+            }
+        }
+    }
+
+    // (4) Concatenate Documents separated by <|endoftext|> in Packing
+    if (packing && !this->texts.empty()){
+        this->texts.push_back(torch::full({this->sequence - 1}, padding, torch::kLong));  // so that the last tokens are also predicted
+        this->texts = std::vector<torch::Tensor>{torch::cat(this->texts, /*dim=*/0)};
+    }
+
+    // (5) Set Index of Sequences in the Order of Sorted Paths (unnecessary for random offsets)
+    this->set_index(stride, padding, indexing);
+    time_end = std::chrono::steady_clock::now();
+    this->stats.seconds = std::chrono::duration<double>(time_end - time_start).count();
+
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> constructor (token ids)
+// -------------------------------------------------------------------------
+// Documents already tokenized (and padded) in memory, e.g. synthetic input of benchmarks.
+datasets::TextFolder::TextFolder(const std::vector<torch::Tensor> &texts_, const long int &sequence_, const long int &stride, const int &padding){
+    this->sequence = sequence_;
+    this->texts = texts_;
+    for (auto &text : this->texts) this->stats.tokens += text.numel();
+    this->stats.files = this->texts.size();
+    this->set_index(stride, padding, /*indexing=*/true);
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{set_index}
+// -------------------------------------------------------------------------
+void datasets::TextFolder::set_index(const long int stride, const int padding, const bool indexing){
+
+    long int numel, tokens, first, lo, hi;
+    double useful_sum, target_sum;
+    torch::Tensor offsets, nonpad, mask;
+
+    useful_sum = 0.0;
+    target_sum = 0.0;
+    this->doc_tokens = std::vector<long int>(this->texts.size(), 0);
+    this->doc_windows = std::vector<std::pair<long int, long int>>(this->texts.size(), {0, 0});
+    for (size_t i = 0; i < this->texts.size(); i++){
+        numel = this->texts.at(i).numel();
+        for (long int j = 0; indexing && (j < numel - this->sequence); j += stride){
             this->paths_idx.push_back(i);
             this->offset_idx.push_back(j);
         }
+        // tokens other than padding, and the offsets whose targets are all of them (one window from the start for short documents)
+        mask = (this->texts.at(i) != padding);
+        tokens = mask.sum().item<long int>();
+        if ((numel > this->sequence) && (tokens > 0)){
+            first = mask.to(torch::kLong).argmax().item<long int>();
+            lo = std::max((long int)0, first - 1);
+            hi = std::max(lo, std::min(first + tokens - 1 - this->sequence, numel - this->sequence - 1));
+            this->doc_tokens.at(i) = tokens;
+            this->doc_windows.at(i) = {lo, hi - lo + 1};
+        }
+        if (this->texts.at(i).numel() > this->sequence){
+            // the number of non-padding targets in [j + 1, j + 1 + sequence) for all offsets j
+            nonpad = torch::cat({torch::zeros({1}, torch::kLong), (this->texts.at(i) != padding).to(torch::kLong).cumsum(0)}, /*dim=*/0);
+            offsets = torch::arange(0, this->texts.at(i).numel() - this->sequence, stride, torch::kLong);
+            useful_sum += (nonpad.index({offsets + 1 + this->sequence}) - nonpad.index({offsets + 1})).sum().item<double>();
+            target_sum += (double)offsets.numel() * (double)this->sequence;
+        }
     }
+    this->useful = (target_sum > 0.0) ? useful_sum / target_sum : 0.0;
+
 }
 
 
@@ -155,6 +549,14 @@ void datasets::TextFolder::get(const size_t idx, std::tuple<torch::Tensor, torch
 }
 
 
+void datasets::TextFolder::get(const size_t doc, const long int offset, std::tuple<torch::Tensor, torch::Tensor> &data){
+    torch::Tensor text_in = this->texts.at(doc).index({Slice(offset, offset + this->sequence)}).contiguous();
+    torch::Tensor text_out = this->texts.at(doc).index({Slice(offset + 1, offset + 1 + this->sequence)}).contiguous();
+    data = {text_in.detach().clone(), text_out.detach().clone()};
+    return;
+}
+
+
 // -------------------------------------------------------------------------
 // namespace{datasets} -> class{TextFolder} -> function{size}
 // -------------------------------------------------------------------------
@@ -163,14 +565,214 @@ size_t datasets::TextFolder::size(){
 }
 
 
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{offset}
+// -------------------------------------------------------------------------
+// Offset of the window 'idx' in its document (0 for the first window of each document).
+long int datasets::TextFolder::offset(const size_t idx){
+    return this->offset_idx.at(idx);
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{documents}
+// -------------------------------------------------------------------------
+size_t datasets::TextFolder::documents(){
+    return this->texts.size();
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{tokens}
+// -------------------------------------------------------------------------
+// The number of tokens other than padding (0 for documents without any window).
+long int datasets::TextFolder::tokens(const size_t doc){
+    return this->doc_tokens.at(doc);
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{windows}
+// -------------------------------------------------------------------------
+// {the first offset, the number of offsets} of the windows over the tokens of the document.
+std::pair<long int, long int> datasets::TextFolder::windows(const size_t doc){
+    return this->doc_windows.at(doc);
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{get_sequence}
+// -------------------------------------------------------------------------
+long int datasets::TextFolder::get_sequence(){
+    return this->sequence;
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{load_stats}
+// -------------------------------------------------------------------------
+datasets::LoadStats datasets::TextFolder::load_stats(){
+    return this->stats;
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{useful_ratio}
+// -------------------------------------------------------------------------
+double datasets::TextFolder::useful_ratio(){
+    return this->useful;
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{token_bytes}
+// -------------------------------------------------------------------------
+size_t datasets::TextFolder::token_bytes(){
+    size_t bytes = 0;
+    for (auto &text : this->texts){
+        bytes += text.nbytes();
+    }
+    return bytes;
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{index_bytes}
+// -------------------------------------------------------------------------
+size_t datasets::TextFolder::index_bytes(){
+    return (this->paths_idx.capacity() + this->offset_idx.capacity()) * sizeof(size_t) + this->texts.capacity() * sizeof(torch::Tensor);
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolder} -> function{token_counts}
+// -------------------------------------------------------------------------
+torch::Tensor datasets::TextFolder::token_counts(const long int vocab_size, const int padding){
+    torch::Tensor counts = torch::zeros({vocab_size}, torch::kLong);
+    for (auto &text : this->texts){
+        counts += torch::bincount(text, /*weights=*/{}, /*minlength=*/vocab_size).narrow(0, 0, vocab_size);
+    }
+    if ((0 <= padding) && (padding < vocab_size)) counts[padding] = 0;
+    return counts;  // {V}
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextShards} -> constructor
+// -------------------------------------------------------------------------
+datasets::TextShards::TextShards(const std::string &root, const long int &sequence_, const long int &stride_, const int &endoftext_, const int &padding_){
+
+    size_t n_windows;
+    std::ifstream ifs;
+    std::vector<uint64_t> lengths;
+
+    this->sequence = sequence_;
+    this->stride = stride_;
+    this->endoftext = endoftext_;
+    this->padding = padding_;
+
+    // Only the number of sequences per shard is kept in memory
+    datasets::collect(root, this->paths);
+    std::sort(this->paths.begin(), this->paths.end());
+    this->total = 0;
+    for (auto &path : this->paths){
+        datasets::Shard_Read_Header(path, ifs, lengths);
+        ifs.close();
+        n_windows = 0;
+        for (auto &length : lengths){
+            // the number of offsets j in [0, (length + 1 + 2 * (sequence - 1)) - sequence) with step stride
+            n_windows += (length + this->sequence - 1 + this->stride - 1) / this->stride;
+        }
+        this->windows.push_back(n_windows);
+        this->total += n_windows;
+    }
+
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextShards} -> function{load}
+// -------------------------------------------------------------------------
+void datasets::TextShards::load(const size_t shard, datasets::TextShard &data){
+
+    long int n_windows;
+    std::ifstream ifs;
+    std::vector<uint64_t> lengths;
+    std::vector<int> ids;
+
+    datasets::Shard_Read_Header(this->paths.at(shard), ifs, lengths);
+    data.texts = std::vector<torch::Tensor>(lengths.size());
+    data.windows_sum = std::vector<size_t>(lengths.size() + 1, 0);
+    for (size_t i = 0; i < lengths.size(); i++){
+        ids.resize(lengths.at(i));
+        ifs.read((char*)ids.data(), lengths.at(i) * sizeof(int32_t));
+        data.texts.at(i) = datasets::Text_Pack(ids, this->sequence, this->endoftext, this->padding);
+        n_windows = std::max(data.texts.at(i).numel() - this->sequence, (long int)0);  // the number of offsets j in [0, numel - sequence) with step stride
+        data.windows_sum.at(i + 1) = data.windows_sum.at(i) + (n_windows + this->stride - 1) / this->stride;
+    }
+    ifs.close();
+
+    return;
+
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextShards} -> function{get}
+// -------------------------------------------------------------------------
+void datasets::TextShards::get(const datasets::TextShard &data, const size_t idx, std::tuple<torch::Tensor, torch::Tensor> &window){
+    // the document is found by binary search on the cumulative counts, and the offset follows from the stride
+    size_t doc = std::upper_bound(data.windows_sum.begin(), data.windows_sum.end(), idx) - data.windows_sum.begin() - 1;
+    long int offset = (long int)(idx - data.windows_sum.at(doc)) * this->stride;
+    // a single copy of sequence + 1 tokens, so that input and target share storage
+    torch::Tensor text = data.texts.at(doc).index({Slice(offset, offset + 1 + this->sequence)}).detach().clone();
+    window = {text.narrow(0, 0, this->sequence), text.narrow(0, 1, this->sequence)};
+    return;
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextShards} -> function{shards}
+// -------------------------------------------------------------------------
+size_t datasets::TextShards::shards(){
+    return this->paths.size();
+}
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextShards} -> function{size}
+// -------------------------------------------------------------------------
+size_t datasets::TextShards::size(){
+    return this->total;
+}
+
+
 // -------------------------------------------------------------------------
 // namespace{datasets} -> class{TextFolderPredictWithPaths} -> constructor
 // -------------------------------------------------------------------------
-datasets::TextFolderPredictWithPaths::TextFolderPredictWithPaths(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer_){
+datasets::TextFolderPredictWithPaths::TextFolderPredictWithPaths(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const size_t num_workers){
+
+    size_t i, j;
+    std::vector<std::vector<int>> ids;
+    std::chrono::steady_clock::time_point time_start, time_end;
+
+    // (1) Collect Files
+    time_start = std::chrono::steady_clock::now();
     datasets::collect(root, "", this->paths, this->fnames);
     std::sort(this->paths.begin(), this->paths.end());
     std::sort(this->fnames.begin(), this->fnames.end());
-    this->tokenizer = tokenizer_;
+
+    // (2) Tokenize Files
+    ids = datasets::Text_Encode(this->paths, tokenizer, num_workers, this->stats);
+    this->texts = std::vector<torch::Tensor>(ids.size());
+    for (i = 0; i < ids.size(); i++){
+        this->texts.at(i) = torch::empty({(long int)ids.at(i).size()}, torch::kLong);
+        int64_t *ptr = this->texts.at(i).data_ptr<int64_t>();
+        for (j = 0; j < ids.at(i).size(); j++) ptr[j] = ids.at(i).at(j);
+    }
+    time_end = std::chrono::steady_clock::now();
+    this->stats.seconds = std::chrono::duration<double>(time_end - time_start).count();
+
 }
 
 
@@ -178,7 +780,7 @@ datasets::TextFolderPredictWithPaths::TextFolderPredictWithPaths(const std::stri
 // namespace{datasets} -> class{TextFolderPredictWithPaths} -> function{get}
 // -------------------------------------------------------------------------
 void datasets::TextFolderPredictWithPaths::get(const size_t idx, std::tuple<torch::Tensor, std::string> &data){
-    torch::Tensor text = datasets::Text_Loader_Predict(this->paths.at(idx), this->tokenizer);
+    torch::Tensor text = this->texts.at(idx);
     std::string fname = this->fnames.at(idx);
     data = {text.detach().clone(), fname};
     return;
@@ -191,3 +793,11 @@ void datasets::TextFolderPredictWithPaths::get(const size_t idx, std::tuple<torc
 size_t datasets::TextFolderPredictWithPaths::size(){
     return this->fnames.size();
 }
+
+
+// -------------------------------------------------------------------------
+// namespace{datasets} -> class{TextFolderPredictWithPaths} -> function{load_stats}
+// -------------------------------------------------------------------------
+datasets::LoadStats datasets::TextFolderPredictWithPaths::load_stats(){
+    return this->stats;
+}
@@ -2,8 +2,11 @@
 #define DATASETS_HPP
 
 #include <string>
+#include <fstream>
 #include <tuple>
 #include <vector>
+#include <utility>
+#include <cstdint>
 // For External Library
 #include <torch/torch.h>
 #include <tokenizers_cpp.h>
@@ -16,11 +19,42 @@ using tokenizers::Tokenizer;
 // -----------------------
 namespace datasets{
 
+    // ------------------------------------------
+    // namespace{datasets} -> struct{LoadStats}
+    // ------------------------------------------
+    struct LoadStats{
+        size_t files = 0;
+        size_t bytes = 0;
+        size_t tokens = 0;
+        double seconds = 0.0;
+    };
+
+    // ------------------------------------------
+    // namespace{datasets} -> struct{TextShard}
+    // ------------------------------------------
+    struct TextShard{
+        std::vector<torch::Tensor> texts;
+        std::vector<size_t> windows_sum;  // cumulative number of sequences before each document (size: documents + 1)
+        size_t size() const{ return this->windows_sum.empty() ? 0 : this->windows_sum.back(); }
+    };
+
+    // Constant
+    constexpr size_t chunk_bytes = 4 << 20;  // files larger than this are tokenized as a stream of chunks
+    constexpr size_t files_per_worker = 16;  // the number of files tokenized by one worker in a batch
+
     // Function Prototype
     void collect(const std::string root, std::vector<std::string> &paths);
     void collect(const std::string root, const std::string sub, std::vector<std::string> &paths, std::vector<std::string> &fnames);
+    std::string Text_Read(const std::string &path);
+    std::vector<std::vector<int>> Text_Encode(const std::vector<std::string> &paths, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const size_t num_workers, LoadStats &stats);
+    torch::Tensor Text_Pack(const std::vector<int> &ids, const long int &sequence, const int &endoftext, const int &padding);
+    size_t Text_Boundary(const std::string &str);
     torch::Tensor Text_Loader(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence, const int &endoftext, const int &padding);
+    torch::Tensor Text_Loader_Stream(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence, const int &endoftext, const int &padding, const size_t num_workers, LoadStats &stats);
     torch::Tensor Text_Loader_Predict(const std::string &path, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer);
+    void Shard_Write(const std::string &path, const std::vector<std::vector<int>> &docs);
+    void Shard_Read_Header(const std::string &path, std::ifstream &ifs, std::vector<uint64_t> &lengths);
+    void Shard_Writer(const std::string &root, const std::string &shard_root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const size_t shard_tokens, const size_t num_workers);
 
     // ------------------------------------------
     // namespace{datasets} -> class{TextFolder}
@@ -29,11 +63,47 @@ namespace datasets{
     private:
         long int sequence;
         std::vector<size_t> paths_idx, offset_idx;
+        std::vector<long int> doc_tokens;
+        std::vector<std::pair<long int, long int>> doc_windows;
         std::vector<torch::Tensor> texts;
+        LoadStats stats;
+        double useful;
+        void set_index(const long int stride, const int padding, const bool indexing);
     public:
         TextFolder(){}
-        TextFolder(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence_, const long int &stride, const int &endoftext, const int &padding);
+        TextFolder(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const long int &sequence_, const long int &stride, const int &endoftext, const int &padding, const size_t num_workers=0, const bool packing=false, const bool indexing=true);
+        TextFolder(const std::vector<torch::Tensor> &texts_, const long int &sequence_, const long int &stride, const int &padding);
         void get(const size_t idx, std::tuple<torch::Tensor, torch::Tensor> &data);
+        void get(const size_t doc, const long int offset, std::tuple<torch::Tensor, torch::Tensor> &data);
+        size_t size();
+        size_t documents();
+        long int offset(const size_t idx);
+        long int tokens(const size_t doc);
+        std::pair<long int, long int> windows(const size_t doc);
+        long int get_sequence();
+        LoadStats load_stats();
+        double useful_ratio();
+        size_t token_bytes();
+        size_t index_bytes();
+        torch::Tensor token_counts(const long int vocab_size, const int padding);
+    };
+
+    // ------------------------------------------
+    // namespace{datasets} -> class{TextShards}
+    // ------------------------------------------
+    class TextShards{
+    private:
+        long int sequence, stride;
+        int endoftext, padding;
+        std::vector<std::string> paths;
+        std::vector<size_t> windows;
+        size_t total;
+    public:
+        TextShards(){}
+        TextShards(const std::string &root, const long int &sequence_, const long int &stride_, const int &endoftext_, const int &padding_);
+        void load(const size_t shard, TextShard &data);
+        void get(const TextShard &data, const size_t idx, std::tuple<torch::Tensor, torch::Tensor> &window);
+        size_t shards();
         size_t size();
     };
 
@@ -43,12 +113,14 @@ namespace datasets{
     class TextFolderPredictWithPaths{
     private:
         std::vector<std::string> paths, fnames;
-        std::shared_ptr<tokenizers::Tokenizer> tokenizer;
+        std::vector<torch::Tensor> texts;
+        LoadStats stats;
     public:
         TextFolderPredictWithPaths(){}
-        TextFolderPredictWithPaths(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer_);
+        TextFolderPredictWithPaths(const std::string &root, const std::shared_ptr<tokenizers::Tokenizer> &tokenizer, const size_t num_workers=0);
         void get(const size_t idx, std::tuple<torch::Tensor, std::string> &data);
         size_t size();
+        LoadStats load_stats();
     };
 
 }
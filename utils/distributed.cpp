@@ -0,0 +1,295 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdlib>
+// For External Library
+#include <torch/torch.h>
+#ifdef USE_C10D_GLOO
+#include <torch/csrc/distributed/c10d/ProcessGroupGloo.hpp>
+#include <torch/csrc/distributed/c10d/FileStore.hpp>
+#include <torch/csrc/distributed/c10d/TCPStore.hpp>
+#endif
+// For Original Header
+#include "distributed.hpp"
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> constructor
+// ----------------------------------------------------------
+distributed::group::group(){
+    this->rank = 0;
+    this->world_size = 1;
+}
+
+distributed::group::group(const size_t rank_, const size_t world_size_, const std::string store_path, const std::string master_addr, const int master_port){
+
+    this->rank = rank_;
+    this->world_size = world_size_;
+    if (this->world_size <= 1) return;
+
+#ifdef USE_C10D_GLOO
+    // (1) Rendezvous through TCP (multiple hosts) or File (one host)
+    c10::intrusive_ptr<c10d::Store> store;
+    if (!master_addr.empty()){
+        c10d::TCPStoreOptions opts;
+        opts.port = (uint16_t)master_port;
+        opts.isServer = (this->rank == 0);
+        opts.numWorkers = this->world_size;
+        store = c10::make_intrusive<c10d::TCPStore>(master_addr, opts);
+    }
+    else{
+        store = c10::make_intrusive<c10d::FileStore>(store_path, (int)this->world_size);
+    }
+
+    // (2) Create Process Group
+    auto options = c10d::ProcessGroupGloo::Options::create();
+    options->devices.push_back(c10d::ProcessGroupGloo::createDefaultDevice());
+    this->pg = c10::make_intrusive<c10d::ProcessGroupGloo>(store, (int)this->rank, (int)this->world_size, options);
+#else
+    std::cerr << "Error : Distributed training requires LibTorch with Gloo (USE_C10D_GLOO)." << std::endl;
+    std::exit(1);
+#endif
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{allreduce}
+// ----------------------------------------------------------
+void distributed::group::allreduce(torch::Tensor &tensor){
+    this->allreduce_async(tensor);
+    this->wait();
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{allreduce_async}
+// ----------------------------------------------------------
+void distributed::group::allreduce_async(torch::Tensor &tensor){
+#ifdef USE_C10D_GLOO
+    if (this->world_size <= 1) return;
+    std::vector<torch::Tensor> tensors{tensor};
+    this->works.push_back(this->pg->allreduce(tensors));
+#endif
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{wait}
+// ----------------------------------------------------------
+void distributed::group::wait(){
+#ifdef USE_C10D_GLOO
+    for (auto &work : this->works){
+        work->wait();
+    }
+    this->works.clear();
+#endif
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{broadcast}
+// ----------------------------------------------------------
+void distributed::group::broadcast(std::vector<torch::Tensor> tensors){
+#ifdef USE_C10D_GLOO
+    if (this->world_size <= 1) return;
+    torch::NoGradGuard no_grad;
+    for (auto &tensor : tensors){
+        std::vector<torch::Tensor> tensor_list{tensor};
+        this->pg->broadcast(tensor_list)->wait();
+    }
+#endif
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{barrier}
+// ----------------------------------------------------------
+void distributed::group::barrier(){
+#ifdef USE_C10D_GLOO
+    if (this->world_size <= 1) return;
+    this->pg->barrier()->wait();
+#endif
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{get_rank}
+// ----------------------------------------------------------
+size_t distributed::group::get_rank(){
+    return this->rank;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{get_world_size}
+// ----------------------------------------------------------
+size_t distributed::group::get_world_size(){
+    return this->world_size;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{group} -> function{is_main}
+// ----------------------------------------------------------
+bool distributed::group::is_main(){
+    return this->rank == 0;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{reducer} -> constructor
+// ----------------------------------------------------------
+distributed::reducer::reducer(std::shared_ptr<group> pg_, std::vector<torch::Tensor> params_, const size_t bucket_bytes){
+
+    size_t i, bytes;
+
+    this->pg = pg_;
+    this->params = params_;
+    this->grads = std::vector<torch::Tensor>(this->params.size());
+    this->bucket_idx = std::vector<size_t>(this->params.size());
+
+    // (1) Assign Parameters to Buckets in Reverse Order (roughly the order in which gradients are computed)
+    bytes = 0;
+    for (i = this->params.size(); i-- > 0;){
+        if (this->buckets.empty() || (bytes >= bucket_bytes)){
+            this->buckets.push_back({});
+            bytes = 0;
+        }
+        this->buckets.back().push_back(i);
+        this->bucket_idx.at(i) = this->buckets.size() - 1;
+        bytes += this->params.at(i).numel() * this->params.at(i).element_size();
+    }
+    this->flat = std::vector<torch::Tensor>(this->buckets.size());
+    this->pending = std::vector<size_t>(this->buckets.size(), 0);
+
+    // (2) Register Hooks called when Gradients are computed
+    for (i = 0; i < this->params.size(); i++){
+        this->hooks.push_back(this->params.at(i).register_hook([this, i](torch::Tensor grad){ this->ready(i, grad); }));
+    }
+    this->next_bucket = 0;
+    this->sync = false;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{reducer} -> function{prepare}
+// ----------------------------------------------------------
+// Call before backward. Gradients are only accumulated locally with 'sync_=false'.
+void distributed::reducer::prepare(const bool sync_){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->sync = sync_ && (this->pg->get_world_size() > 1);
+    this->next_bucket = 0;
+    for (size_t b = 0; b < this->buckets.size(); b++){
+        this->pending.at(b) = this->buckets.at(b).size();
+    }
+    for (auto &grad : this->grads){
+        grad = torch::Tensor();
+    }
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{reducer} -> function{ready}
+// ----------------------------------------------------------
+void distributed::reducer::ready(const size_t i, const torch::Tensor &grad){
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (!this->sync) return;
+
+    // (1) Keep Gradient including the previously accumulated one
+    if (this->params.at(i).grad().defined()){
+        this->grads.at(i) = this->params.at(i).grad() + grad;
+    }
+    else{
+        this->grads.at(i) = grad;
+    }
+
+    // (2) Launch Buckets in the same Order on all Processes
+    this->pending.at(this->bucket_idx.at(i))--;
+    while ((this->next_bucket < this->buckets.size()) && (this->pending.at(this->next_bucket) == 0)){
+        this->launch(this->next_bucket);
+        this->next_bucket++;
+    }
+
+    return;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{reducer} -> function{launch}
+// ----------------------------------------------------------
+void distributed::reducer::launch(const size_t b){
+    torch::NoGradGuard no_grad;
+    std::vector<torch::Tensor> views;
+    for (auto &j : this->buckets.at(b)){
+        if (this->grads.at(j).defined()) views.push_back(this->grads.at(j).reshape({-1}));
+        else if (this->params.at(j).grad().defined()) views.push_back(this->params.at(j).grad().reshape({-1}));
+        else views.push_back(torch::zeros_like(this->params.at(j)).reshape({-1}));
+    }
+    this->flat.at(b) = torch::cat(views, /*dim=*/0);
+    this->pg->allreduce_async(this->flat.at(b));
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{reducer} -> function{finalize}
+// ----------------------------------------------------------
+// Call after backward. The gradients of parameters are replaced by the average over processes.
+void distributed::reducer::finalize(){
+
+    size_t offset;
+    torch::Tensor grad;
+
+    if (!this->sync) return;
+
+    // (1) Launch Buckets including Parameters not used in this Step
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        for (; this->next_bucket < this->buckets.size(); this->next_bucket++){
+            this->launch(this->next_bucket);
+        }
+    }
+
+    // (2) Wait for All-Reduce
+    this->pg->wait();
+
+    // (3) Set Averaged Gradients
+    torch::NoGradGuard no_grad;
+    for (size_t b = 0; b < this->buckets.size(); b++){
+        this->flat.at(b).div_((double)this->pg->get_world_size());
+        offset = 0;
+        for (auto &j : this->buckets.at(b)){
+            grad = this->flat.at(b).narrow(0, offset, this->params.at(j).numel()).view_as(this->params.at(j));
+            if (this->params.at(j).grad().defined()) this->params.at(j).mutable_grad().copy_(grad);
+            else this->params.at(j).mutable_grad() = grad.clone();
+            offset += this->params.at(j).numel();
+        }
+        this->flat.at(b) = torch::Tensor();
+    }
+    this->sync = false;
+
+    return;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{distributed} -> class{reducer} -> destructor
+// ----------------------------------------------------------
+distributed::reducer::~reducer(){
+    for (size_t i = 0; i < this->hooks.size(); i++){
+        this->params.at(i).remove_hook(this->hooks.at(i));
+    }
+}
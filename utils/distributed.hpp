@@ -0,0 +1,71 @@
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+// For External Library
+#include <torch/torch.h>
+#ifdef USE_C10D_GLOO
+#include <torch/csrc/distributed/c10d/ProcessGroupGloo.hpp>
+#endif
+
+
+// -----------------------------------
+// namespace{distributed}
+// -----------------------------------
+namespace distributed{
+
+    // -----------------------------------------
+    // namespace{distributed} -> class{group}
+    // -----------------------------------------
+    class group{
+    private:
+        size_t rank, world_size;
+#ifdef USE_C10D_GLOO
+        c10::intrusive_ptr<c10d::ProcessGroupGloo> pg;
+        std::vector<c10::intrusive_ptr<c10d::Work>> works;
+#endif
+    public:
+        group();
+        group(const size_t rank_, const size_t world_size_, const std::string store_path, const std::string master_addr, const int master_port);
+        void allreduce(torch::Tensor &tensor);
+        void allreduce_async(torch::Tensor &tensor);
+        void wait();
+        void broadcast(std::vector<torch::Tensor> tensors);
+        void barrier();
+        size_t get_rank();
+        size_t get_world_size();
+        bool is_main();
+    };
+
+    // -----------------------------------------
+    // namespace{distributed} -> class{reducer}
+    // -----------------------------------------
+    // Averages gradients over processes in buckets of parameters.
+    // Each bucket is all-reduced asynchronously as soon as the gradients of its parameters are computed in backward,
+    // so that the communication overlaps with the backward of the remaining layers.
+    class reducer{
+    private:
+        std::shared_ptr<group> pg;
+        std::vector<torch::Tensor> params;
+        std::vector<unsigned> hooks;
+        std::vector<std::vector<size_t>> buckets;
+        std::vector<size_t> bucket_idx, pending;
+        std::vector<torch::Tensor> grads, flat;
+        size_t next_bucket;
+        bool sync;
+        std::mutex mtx;
+        void ready(const size_t i, const torch::Tensor &grad);
+        void launch(const size_t b);
+    public:
+        reducer(std::shared_ptr<group> pg_, std::vector<torch::Tensor> params_, const size_t bucket_bytes);
+        void prepare(const bool sync_=true);
+        void finalize();
+        ~reducer();
+    };
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <ios>
+#include <iomanip>
+// For External Library
+#include <torch/torch.h>
+#ifdef MEMORY_CUDA_STATS
+#include <c10/cuda/CUDACachingAllocator.h>
+#endif
+// For Original Header
+#include "memory.hpp"
+#include "optimizers.hpp"
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Process_Usage}
+// ---------------------------------------------------------
+memory::Process memory::Process_Usage(){
+
+    Process usage;
+    std::string line;
+    std::ifstream ifs("/proc/self/status", std::ios::in);
+
+    while (std::getline(ifs, line)){
+        std::stringstream ss(line.substr(line.find(':') + 1));
+        size_t kb = 0;
+        if (line.rfind("VmRSS:", 0) == 0){
+            ss >> kb;
+            usage.rss = kb << 10;
+        }
+        else if (line.rfind("VmHWM:", 0) == 0){
+            ss >> kb;
+            usage.hwm = kb << 10;
+        }
+    }
+
+    return usage;
+
+}
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Device_Usage}
+// ---------------------------------------------------------
+memory::Device memory::Device_Usage(const torch::Device &device){
+    Device usage;
+#ifdef MEMORY_CUDA_STATS
+    if (device.is_cuda()){
+        auto stats = c10::cuda::CUDACachingAllocator::getDeviceStats(device.index());
+        constexpr size_t aggregate = 0;  // StatType::AGGREGATE
+        usage.available = true;
+        usage.allocated = stats.allocated_bytes[aggregate].current;
+        usage.peak = stats.allocated_bytes[aggregate].peak;
+        usage.reserved = stats.reserved_bytes[aggregate].current;
+    }
+#endif
+    return usage;
+}
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Reset_Peak}
+// ---------------------------------------------------------
+// Restarts the peak of the process (VmHWM, Linux 4.0+) and of the CUDA caching allocator.
+void memory::Reset_Peak(const torch::Device &device){
+    std::ofstream ofs("/proc/self/clear_refs", std::ios::out);
+    if (ofs.good()) ofs << "5" << std::flush;
+#ifdef MEMORY_CUDA_STATS
+    if (device.is_cuda()) c10::cuda::CUDACachingAllocator::resetPeakStats(device.index());
+#endif
+    return;
+}
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Tensor_Bytes}
+// ---------------------------------------------------------
+size_t memory::Tensor_Bytes(const std::vector<torch::Tensor> &tensors){
+    size_t bytes = 0;
+    for (auto &tensor : tensors){
+        if (tensor.defined()) bytes += tensor.numel() * tensor.element_size();
+    }
+    return bytes;
+}
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Grad_Bytes}
+// ---------------------------------------------------------
+size_t memory::Grad_Bytes(const std::vector<torch::Tensor> &params){
+    size_t bytes = 0;
+    for (auto &param : params){
+        if (param.grad().defined()) bytes += param.grad().numel() * param.grad().element_size();
+    }
+    return bytes;
+}
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Optimizer_Bytes}
+// ---------------------------------------------------------
+// States allocated by the optimizer (torch::optim::Adam creates them at the first step).
+size_t memory::Optimizer_Bytes(torch::optim::Optimizer &optimizer){
+
+    size_t bytes = 0;
+
+    // (1) Fused AdamW
+    if (auto adamw = dynamic_cast<optimizers::AdamW*>(&optimizer)){
+        return adamw->state_bytes();
+    }
+
+    // (2) torch::optim::Adam
+    for (auto &state : optimizer.state()){
+        if (auto adam = dynamic_cast<torch::optim::AdamParamState*>(state.second.get())){
+            bytes += Tensor_Bytes({adam->exp_avg(), adam->exp_avg_sq(), adam->max_exp_avg_sq()});
+        }
+    }
+
+    return bytes;
+
+}
+
+
+// ---------------------------------------------------------
+// namespace{memory} -> function{Report}
+// ---------------------------------------------------------
+std::string memory::Report(const std::string phase, const std::vector<std::pair<std::string, size_t>> &items, const torch::Device &device){
+
+    constexpr double MB = 1024.0 * 1024.0;
+
+    size_t total;
+    std::stringstream ss;
+    Process process;
+    Device dev;
+
+    // (1) Components
+    total = 0;
+    ss << "Memory (" << phase << ")" << std::endl;
+    ss << std::fixed << std::setprecision(1);
+    for (auto &item : items){
+        ss << "  " << std::left << std::setw(40) << item.first << std::right << std::setw(12) << (double)item.second / MB << " MB" << std::endl;
+        total += item.second;
+    }
+    ss << "  " << std::left << std::setw(40) << "total of the above" << std::right << std::setw(12) << (double)total / MB << " MB" << std::endl;
+
+    // (2) Process and Device
+    process = Process_Usage();
+    ss << "  " << std::left << std::setw(40) << "process RSS (current / peak)" << std::right << std::setw(12) << (double)process.rss / MB << " MB / " << (double)process.hwm / MB << " MB" << std::endl;
+    dev = Device_Usage(device);
+    if (dev.available){
+        ss << "  " << std::left << std::setw(40) << "CUDA allocated (current / peak)" << std::right << std::setw(12) << (double)dev.allocated / MB << " MB / " << (double)dev.peak / MB << " MB" << std::endl;
+        ss << "  " << std::left << std::setw(40) << "CUDA reserved" << std::right << std::setw(12) << (double)dev.reserved / MB << " MB" << std::endl;
+    }
+
+    return ss.str();
+
+}
@@ -0,0 +1,43 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+// For External Library
+#include <torch/torch.h>
+
+
+// -----------------------------------
+// namespace{memory}
+// -----------------------------------
+namespace memory{
+
+    // ------------------------------------------
+    // namespace{memory} -> struct{Process}
+    // ------------------------------------------
+    struct Process{
+        size_t rss = 0;  // resident set size (VmRSS)
+        size_t hwm = 0;  // peak resident set size (VmHWM)
+    };
+
+    // ------------------------------------------
+    // namespace{memory} -> struct{Device}
+    // ------------------------------------------
+    struct Device{
+        bool available = false;  // statistics of the CUDA caching allocator
+        size_t allocated = 0, peak = 0, reserved = 0;
+    };
+
+    // Function Prototype
+    Process Process_Usage();
+    Device Device_Usage(const torch::Device &device);
+    void Reset_Peak(const torch::Device &device);
+    size_t Tensor_Bytes(const std::vector<torch::Tensor> &tensors);
+    size_t Grad_Bytes(const std::vector<torch::Tensor> &params);
+    size_t Optimizer_Bytes(torch::optim::Optimizer &optimizer);
+    std::string Report(const std::string phase, const std::vector<std::pair<std::string, size_t>> &items, const torch::Device &device);
+
+}
+
+#endif
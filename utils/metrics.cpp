@@ -0,0 +1,191 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <initializer_list>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+// For Original Header
+#include "metrics.hpp"
+
+// Define Namespace
+namespace fs = std::filesystem;
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> constructor
+// ---------------------------------------------------------------
+metrics::logger::logger(const bool enabled_, const size_t capacity, const size_t interval_ms_){
+    size_t size = 1;
+    while (size < std::max((size_t)2, capacity)) size <<= 1;
+    this->enabled = enabled_;
+    this->ring = std::vector<Record>(size);
+    this->mask = size - 1;
+    this->head = 0;
+    this->tail = 0;
+    this->stopped = false;
+    this->interval_ms = std::max((size_t)1, interval_ms_);
+    if (this->enabled) this->thread = std::thread(&metrics::logger::run, this);
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> function{add}
+// ---------------------------------------------------------------
+// Adds the files of one kind of records, and returns the id of the stream for push() and text().
+size_t metrics::logger::add(const std::string text_path, const std::string csv_path, const std::vector<std::string> columns, std::function<std::string(const double*)> format, const bool append){
+
+    bool header;
+    std::ios::openmode mode;
+    std::shared_ptr<Stream> stream;
+
+    if (!this->enabled) return 0;
+
+    // (1) Open Files
+    mode = append ? std::ios::app : std::ios::out;
+    stream = std::make_shared<Stream>();
+    stream->format = format;
+    stream->text.open(text_path, mode);
+    header = !append || !fs::exists(csv_path) || (fs::file_size(csv_path) == 0);
+    stream->csv.open(csv_path, mode);
+    if (stream->text.fail() || stream->csv.fail()){
+        std::cerr << "Error : Couldn't open the log files '" << text_path << "' and '" << csv_path << "'." << std::endl;
+        std::exit(1);
+    }
+    stream->csv.precision(9);
+
+    // (2) Write Header of CSV
+    if (header){
+        for (size_t i = 0; i < columns.size(); i++){
+            stream->csv << (i == 0 ? "" : ",") << columns.at(i);
+        }
+        stream->csv << '\n';
+    }
+
+    // (3) Register Stream
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->streams.push_back(stream);
+    return this->streams.size() - 1;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> function{acquire}
+// ---------------------------------------------------------------
+// Returns the next free slot of the ring (waits only when the writer is behind by the whole ring).
+metrics::Record &metrics::logger::acquire(){
+    size_t h = this->head.load(std::memory_order_relaxed);
+    while (h - this->tail.load(std::memory_order_acquire) > this->mask){
+        std::this_thread::yield();
+    }
+    return this->ring.at(h & this->mask);
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> function{push}
+// ---------------------------------------------------------------
+void metrics::logger::push(const size_t stream, std::initializer_list<double> values){
+    if (!this->enabled) return;
+    Record &record = this->acquire();
+    record.stream = stream;
+    record.size = std::min(values.size(), max_values);
+    std::copy_n(values.begin(), record.size, record.values);
+    record.is_text = false;
+    this->head.fetch_add(1, std::memory_order_release);
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> function{text}
+// ---------------------------------------------------------------
+// Writes a line only to the text view (e.g. headers of epochs and summaries).
+void metrics::logger::text(const size_t stream, const std::string line){
+    if (!this->enabled) return;
+    Record &record = this->acquire();
+    record.stream = stream;
+    record.size = 0;
+    record.is_text = true;
+    record.text = line;
+    this->head.fetch_add(1, std::memory_order_release);
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> function{drain}
+// ---------------------------------------------------------------
+void metrics::logger::drain(){
+
+    size_t t, h;
+    std::vector<std::shared_ptr<Stream>> streams_;
+
+    // (1) Get Records put until now
+    t = this->tail.load(std::memory_order_relaxed);
+    h = this->head.load(std::memory_order_acquire);
+    if (t == h) return;
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        streams_ = this->streams;
+    }
+
+    // (2) Write Records
+    for (; t != h; t++){
+        Record &record = this->ring.at(t & this->mask);
+        auto &stream = streams_.at(record.stream);
+        if (record.is_text){
+            stream->text << record.text << '\n';
+            continue;
+        }
+        stream->text << stream->format(record.values) << '\n';
+        for (size_t i = 0; i < record.size; i++){
+            stream->csv << (i == 0 ? "" : ",") << record.values[i];
+        }
+        stream->csv << '\n';
+    }
+    this->tail.store(t, std::memory_order_release);
+
+    // (3) Flush Files once per Batch
+    for (auto &stream : streams_){
+        stream->text.flush();
+        stream->csv.flush();
+    }
+
+    return;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> function{run}
+// ---------------------------------------------------------------
+void metrics::logger::run(){
+    while (!this->stopped.load(std::memory_order_acquire)){
+        std::this_thread::sleep_for(std::chrono::milliseconds(this->interval_ms));
+        this->drain();
+    }
+    this->drain();
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{metrics} -> class{logger} -> destructor
+// ---------------------------------------------------------------
+metrics::logger::~logger(){
+    this->stopped.store(true, std::memory_order_release);
+    if (this->thread.joinable()) this->thread.join();
+    for (auto &stream : this->streams){
+        stream->text.close();
+        stream->csv.close();
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+
+// -----------------------------------
+// namespace{metrics}
+// -----------------------------------
+namespace metrics{
+
+    constexpr size_t max_values = 8;  // the maximum number of values per record
+
+    // -----------------------------------
+    // namespace{metrics} -> struct{Record}
+    // -----------------------------------
+    struct Record{
+        size_t stream;
+        size_t size;
+        double values[max_values];
+        bool is_text;
+        std::string text;
+    };
+
+    // -----------------------------------
+    // namespace{metrics} -> struct{Stream}
+    // -----------------------------------
+    // A text view (the existing log file) and a CSV of the same records.
+    struct Stream{
+        std::ofstream text, csv;
+        std::function<std::string(const double*)> format;
+    };
+
+    // -----------------------------------
+    // namespace{metrics} -> class{logger}
+    // -----------------------------------
+    // Records are put into a single-producer single-consumer ring without locks by the training loop,
+    // and a background thread formats and writes them to the files in batches.
+    class logger{
+    private:
+        bool enabled;
+        std::vector<Record> ring;
+        size_t mask;
+        std::atomic<size_t> head, tail;
+        std::atomic<bool> stopped;
+        size_t interval_ms;
+        std::vector<std::shared_ptr<Stream>> streams;
+        std::mutex mtx;
+        std::thread thread;
+        Record &acquire();
+        void drain();
+        void run();
+    public:
+        logger(const bool enabled_=true, const size_t capacity=4096, const size_t interval_ms_=200);
+        size_t add(const std::string text_path, const std::string csv_path, const std::vector<std::string> columns, std::function<std::string(const double*)> format, const bool append=true);
+        void push(const size_t stream, std::initializer_list<double> values);
+        void text(const size_t stream, const std::string line);
+        ~logger();
+    };
+
+}
+
+#endif
@@ -0,0 +1,376 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+// For External Library
+#include <torch/torch.h>
+#include <ATen/Parallel.h>
+// For Original Header
+#include "optimizers.hpp"
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> function{Decay_Groups}
+// ----------------------------------------------------------
+std::vector<torch::optim::OptimizerParamGroup> optimizers::Decay_Groups(std::vector<torch::Tensor> params, const torch::optim::AdamWOptions &options){
+
+    std::vector<std::vector<torch::Tensor>> split;
+    std::vector<torch::optim::OptimizerParamGroup> groups;
+
+    split = arena::Decay_Split(params);
+    groups.push_back(torch::optim::OptimizerParamGroup(split.at(0), std::make_unique<torch::optim::AdamWOptions>(options)));
+    groups.push_back(torch::optim::OptimizerParamGroup(split.at(1), std::make_unique<torch::optim::AdamWOptions>(torch::optim::AdamWOptions(options).weight_decay(0.0))));
+
+    return groups;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> function{Dynamic_Map}
+// ----------------------------------------------------------
+// 256 sorted values in [-1,1] (signed) or [0,1] (unsigned) for dynamic 8-bit quantization.
+// Each decade from 1e-6 to 1 gets twice as many values as the one below, so that small values keep their relative precision.
+torch::Tensor optimizers::Dynamic_Map(const bool is_signed){
+
+    constexpr int max_exponent_bits = 7;
+    constexpr int non_sign_bits = 7;
+    int i, j, fraction_items;
+    double scale, lower, upper;
+    std::vector<float> data;
+
+    for (i = 0; i < max_exponent_bits; i++){
+        fraction_items = is_signed ? (1 << (i + non_sign_bits - max_exponent_bits)) + 1 : (1 << (i + non_sign_bits - max_exponent_bits + 1)) + 1;
+        scale = std::pow(10.0, -(max_exponent_bits - 1) + i);
+        for (j = 0; j < fraction_items - 1; j++){
+            lower = 0.1 + 0.9 * (double)j / (double)(fraction_items - 1);
+            upper = 0.1 + 0.9 * (double)(j + 1) / (double)(fraction_items - 1);
+            data.push_back(scale * (lower + upper) * 0.5);
+            if (is_signed) data.push_back(-scale * (lower + upper) * 0.5);
+        }
+    }
+    data.push_back(0.0);
+    data.push_back(1.0);
+    while (data.size() < 256) data.push_back(0.0);
+    std::sort(data.begin(), data.end());
+
+    return torch::from_blob(data.data(), {(long int)data.size()}, torch::kFloat).clone();  // {256}
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> function{Quantize}
+// ----------------------------------------------------------
+// Code of the nearest value in the sorted map of 256 values.
+uint8_t optimizers::Quantize(const float *map, const float x){
+    const long int idx = std::lower_bound(map, map + 256, x) - map;
+    if (idx == 0) return 0;
+    if (idx == 256) return 255;
+    return (x - map[idx - 1] < map[idx] - x) ? (uint8_t)(idx - 1) : (uint8_t)idx;
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> function{State_Bytes}
+// ----------------------------------------------------------
+// Bytes of the two moments of Adam for 'numel' parameters (an estimate before the first step).
+size_t optimizers::State_Bytes(const int64_t numel, const size_t bits){
+    int64_t nblocks = (numel + quant_block - 1) / quant_block;
+    if (bits == 8) return 2 * (nblocks * quant_block * sizeof(uint8_t) + nblocks * sizeof(float));
+    return 2 * numel * sizeof(float);
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> function{Quantize_Tensor}
+// ----------------------------------------------------------
+torch::Tensor optimizers::Quantize_Tensor(const torch::Tensor &map, const torch::Tensor &x){
+    torch::Tensor idx, lower, upper;
+    idx = torch::searchsorted(map, x).clamp(1, 255);
+    lower = map.index({idx - 1});
+    upper = map.index({idx});
+    idx = torch::where(x - lower < upper - x, idx - 1, idx);
+    return idx.to(torch::kByte);
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> constructor
+// ----------------------------------------------------------
+optimizers::AdamW::AdamW(std::vector<torch::Tensor> params, torch::optim::AdamWOptions options, const size_t bits_, std::shared_ptr<arena::ParamArena> arena_) : torch::optim::Optimizer(Decay_Groups(params, options), std::make_unique<torch::optim::AdamWOptions>(options)){
+
+    int64_t total, nblocks;
+
+    torch::NoGradGuard no_grad;
+    this->step_count = 0;
+    this->bits = bits_;
+    if ((this->bits != 32) && (this->bits != 8)){
+        std::cerr << "Error : The optimizer states must be 32 or 8 bits." << std::endl;
+        std::exit(1);
+    }
+    this->map_signed = Dynamic_Map(/*is_signed=*/true);
+    this->map_unsigned = Dynamic_Map(/*is_signed=*/false);
+
+    // (1) Get Flat Buffers of Parameters and Gradients
+    if (arena_ == nullptr){
+        this->param_arena = std::make_shared<arena::ParamArena>(arena::Decay_Split(params));
+    }
+    else{
+        this->param_arena = arena_;
+        if ((this->param_arena->groups() != this->param_groups_.size()) || (this->param_arena->members(0).size() != this->param_groups_.at(0).params().size())){
+            std::cerr << "Error : The parameter arena must be split into decay groups (arena::Decay_Split)." << std::endl;
+            std::exit(1);
+        }
+    }
+
+    // (2) Allocate Flat Buffers of Moments
+    for (size_t g = 0; g < this->param_groups_.size(); g++){
+        total = this->param_arena->params(g).numel();
+        auto opts = this->param_arena->params(g).options();
+        if (this->bits == 8){
+            nblocks = (total + quant_block - 1) / quant_block;
+            this->M.push_back(torch::zeros({nblocks * quant_block}, opts.dtype(torch::kByte)));
+            this->V.push_back(torch::zeros({nblocks * quant_block}, opts.dtype(torch::kByte)));
+            this->M_absmax.push_back(torch::zeros({nblocks}, opts.dtype(torch::kFloat)));
+            this->V_absmax.push_back(torch::zeros({nblocks}, opts.dtype(torch::kFloat)));  // all codes decode to zero with zero scale
+        }
+        else{
+            this->M.push_back(torch::zeros({total}, opts));
+            this->V.push_back(torch::zeros({total}, opts));
+        }
+    }
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> function{step}
+// ----------------------------------------------------------
+torch::Tensor optimizers::AdamW::step(LossClosure closure){
+
+    torch::Tensor loss;
+
+    if (closure != nullptr){
+        torch::AutoGradMode enable_grad(true);
+        loss = closure();
+    }
+
+    torch::NoGradGuard no_grad;
+    this->step_count++;
+    for (size_t g = 0; g < this->param_groups_.size(); g++){
+
+        // (1) Bring Parameters and Gradients back into the Flat Buffers
+        this->param_arena->attach(g);
+
+        // (2) Update
+        if (this->bits == 8) this->update_8bit(g);
+        else this->update(g);
+
+    }
+
+    return loss;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> function{update}
+// ----------------------------------------------------------
+void optimizers::AdamW::update(const size_t g){
+
+    auto &options = static_cast<torch::optim::AdamWOptions&>(this->param_groups_.at(g).options());
+    const double lr = options.lr();
+    const double beta1 = std::get<0>(options.betas());
+    const double beta2 = std::get<1>(options.betas());
+    const double eps = options.eps();
+    const double decay = 1.0 - lr * options.weight_decay();
+    const double step_size = lr / (1.0 - std::pow(beta1, this->step_count));
+    const double bias_correction2_sqrt = std::sqrt(1.0 - std::pow(beta2, this->step_count));
+    torch::Tensor denom;
+
+    if (this->param_arena->params(g).numel() == 0) return;
+
+    // (1) CPU Kernel (float)
+    if (this->param_arena->params(g).is_cpu() && (this->param_arena->params(g).scalar_type() == torch::kFloat)){
+        float *p = this->param_arena->params(g).data_ptr<float>();
+        float *grad = this->param_arena->grads(g).data_ptr<float>();
+        float *m = this->M.at(g).data_ptr<float>();
+        float *v = this->V.at(g).data_ptr<float>();
+        const float b1 = beta1, b2 = beta2, e = eps, d = decay, s = step_size, c2 = bias_correction2_sqrt;
+        at::parallel_for(0, this->param_arena->params(g).numel(), /*grain_size=*/16384, [&](int64_t begin, int64_t end){
+            #pragma omp simd
+            for (int64_t i = begin; i < end; i++){
+                m[i] = b1 * m[i] + (1.0f - b1) * grad[i];
+                v[i] = b2 * v[i] + (1.0f - b2) * grad[i] * grad[i];
+                p[i] = p[i] * d - s * m[i] / (std::sqrt(v[i]) / c2 + e);
+            }
+        });
+    }
+    // (2) Other Devices (a few kernels over the whole buffer)
+    else{
+        this->M.at(g).mul_(beta1).add_(this->param_arena->grads(g), 1.0 - beta1);
+        this->V.at(g).mul_(beta2).addcmul_(this->param_arena->grads(g), this->param_arena->grads(g), 1.0 - beta2);
+        denom = (this->V.at(g).sqrt() / bias_correction2_sqrt).add_(eps);
+        this->param_arena->params(g).mul_(decay).addcdiv_(this->M.at(g), denom, -step_size);
+    }
+
+    return;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> function{update_8bit}
+// ----------------------------------------------------------
+// Each block is decoded, updated in float, used to update the parameters, and encoded again with its new absmax.
+void optimizers::AdamW::update_8bit(const size_t g){
+
+    auto &options = static_cast<torch::optim::AdamWOptions&>(this->param_groups_.at(g).options());
+    const double lr = options.lr();
+    const double beta1 = std::get<0>(options.betas());
+    const double beta2 = std::get<1>(options.betas());
+    const double eps = options.eps();
+    const double decay = 1.0 - lr * options.weight_decay();
+    const double step_size = lr / (1.0 - std::pow(beta1, this->step_count));
+    const double bias_correction2_sqrt = std::sqrt(1.0 - std::pow(beta2, this->step_count));
+    const int64_t n = this->param_arena->params(g).numel();
+    const int64_t nblocks = this->M_absmax.at(g).numel();
+    torch::Tensor map_m, map_v, grad, m, v, denom, m_absmax, v_absmax;
+
+    if (n == 0) return;
+
+    // (1) CPU Kernel (float)
+    if (this->param_arena->params(g).is_cpu() && (this->param_arena->params(g).scalar_type() == torch::kFloat)){
+        float *p = this->param_arena->params(g).data_ptr<float>();
+        float *grad_ptr = this->param_arena->grads(g).data_ptr<float>();
+        uint8_t *m_code = this->M.at(g).data_ptr<uint8_t>();
+        uint8_t *v_code = this->V.at(g).data_ptr<uint8_t>();
+        float *m_max = this->M_absmax.at(g).data_ptr<float>();
+        float *v_max = this->V_absmax.at(g).data_ptr<float>();
+        const float *qm = this->map_signed.data_ptr<float>();
+        const float *qv = this->map_unsigned.data_ptr<float>();
+        const float b1 = beta1, b2 = beta2, e = eps, d = decay, s = step_size, c2 = bias_correction2_sqrt;
+        at::parallel_for(0, nblocks, /*grain_size=*/1, [&](int64_t begin, int64_t end){
+            std::vector<float> m_buff(quant_block), v_buff(quant_block);
+            float *mb = m_buff.data(), *vb = v_buff.data();
+            for (int64_t b = begin; b < end; b++){
+                const int64_t start = b * quant_block;
+                const int64_t len = std::min(quant_block, n - start);
+                float new_m_max = 0.0f, new_v_max = 0.0f;
+                // (1.1) Decode and Update Moments
+                for (int64_t i = 0; i < len; i++){
+                    const float gi = grad_ptr[start + i];
+                    mb[i] = b1 * qm[m_code[start + i]] * m_max[b] + (1.0f - b1) * gi;
+                    vb[i] = b2 * qv[v_code[start + i]] * v_max[b] + (1.0f - b2) * gi * gi;
+                    new_m_max = std::max(new_m_max, std::abs(mb[i]));
+                    new_v_max = std::max(new_v_max, vb[i]);
+                }
+                // (1.2) Update Parameters
+                #pragma omp simd
+                for (int64_t i = 0; i < len; i++){
+                    p[start + i] = p[start + i] * d - s * mb[i] / (std::sqrt(vb[i]) / c2 + e);
+                }
+                // (1.3) Encode Moments
+                m_max[b] = new_m_max;
+                v_max[b] = new_v_max;
+                for (int64_t i = 0; i < len; i++){
+                    m_code[start + i] = Quantize(qm, (new_m_max > 0.0f) ? mb[i] / new_m_max : 0.0f);
+                    v_code[start + i] = Quantize(qv, (new_v_max > 0.0f) ? vb[i] / new_v_max : 0.0f);
+                }
+            }
+        });
+    }
+    // (2) Other Devices (decoded to float temporarily)
+    else{
+        map_m = this->map_signed.to(this->param_arena->params(g).device());
+        map_v = this->map_unsigned.to(this->param_arena->params(g).device());
+        grad = torch::zeros({nblocks * quant_block}, this->param_arena->params(g).options());
+        grad.narrow(0, 0, n).copy_(this->param_arena->grads(g));
+        grad = grad.view({nblocks, quant_block});
+        m = map_m.index({this->M.at(g).to(torch::kLong)}).view({nblocks, quant_block}) * this->M_absmax.at(g).unsqueeze(1);
+        v = map_v.index({this->V.at(g).to(torch::kLong)}).view({nblocks, quant_block}) * this->V_absmax.at(g).unsqueeze(1);
+        m.mul_(beta1).add_(grad, 1.0 - beta1);
+        v.mul_(beta2).addcmul_(grad, grad, 1.0 - beta2);
+        denom = (v.sqrt() / bias_correction2_sqrt).add_(eps);
+        this->param_arena->params(g).mul_(decay).addcdiv_(m.view({-1}).narrow(0, 0, n), denom.view({-1}).narrow(0, 0, n), -step_size);
+        m_absmax = m.abs().amax(/*dim=*/1);
+        v_absmax = v.amax(/*dim=*/1);
+        this->M_absmax.at(g).copy_(m_absmax);
+        this->V_absmax.at(g).copy_(v_absmax);
+        this->M.at(g).copy_(Quantize_Tensor(map_m, m / m_absmax.clamp_min(1e-30).unsqueeze(1)).view({-1}));
+        this->V.at(g).copy_(Quantize_Tensor(map_v, v / v_absmax.clamp_min(1e-30).unsqueeze(1)).view({-1}));
+    }
+
+    return;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> function{state_bytes}
+// ----------------------------------------------------------
+size_t optimizers::AdamW::state_bytes(){
+    size_t bytes = 0;
+    for (auto states : {&this->M, &this->V, &this->M_absmax, &this->V_absmax}){
+        for (auto &state : *states){
+            if (state.defined()) bytes += state.nbytes();
+        }
+    }
+    return bytes;
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> function{save}
+// ----------------------------------------------------------
+void optimizers::AdamW::save(torch::serialize::OutputArchive &archive) const{
+    archive.write("step", torch::tensor(this->step_count));
+    archive.write("bits", torch::tensor((int64_t)this->bits));
+    for (size_t g = 0; g < this->M.size(); g++){
+        archive.write("exp_avg_" + std::to_string(g), this->M.at(g));
+        archive.write("exp_avg_sq_" + std::to_string(g), this->V.at(g));
+        if (this->bits == 8){
+            archive.write("exp_avg_absmax_" + std::to_string(g), this->M_absmax.at(g));
+            archive.write("exp_avg_sq_absmax_" + std::to_string(g), this->V_absmax.at(g));
+        }
+    }
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{optimizers} -> class{AdamW} -> function{load}
+// ----------------------------------------------------------
+void optimizers::AdamW::load(torch::serialize::InputArchive &archive){
+    torch::Tensor step, bits_saved, m, v;
+    torch::NoGradGuard no_grad;
+    archive.read("step", step);
+    archive.read("bits", bits_saved);
+    if (bits_saved.item<int64_t>() != (int64_t)this->bits){
+        std::cerr << "Error : The optimizer states were saved with " << bits_saved.item<int64_t>() << " bits, but " << this->bits << " bits are used now." << std::endl;
+        std::exit(1);
+    }
+    this->step_count = step.item<int64_t>();
+    for (size_t g = 0; g < this->M.size(); g++){
+        archive.read("exp_avg_" + std::to_string(g), m);
+        archive.read("exp_avg_sq_" + std::to_string(g), v);
+        this->M.at(g).copy_(m);
+        this->V.at(g).copy_(v);
+        m = torch::Tensor();
+        v = torch::Tensor();
+        if (this->bits == 8){
+            archive.read("exp_avg_absmax_" + std::to_string(g), m);
+            archive.read("exp_avg_sq_absmax_" + std::to_string(g), v);
+            this->M_absmax.at(g).copy_(m);
+            this->V_absmax.at(g).copy_(v);
+            m = torch::Tensor();
+            v = torch::Tensor();
+        }
+    }
+    return;
+}
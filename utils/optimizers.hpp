@@ -0,0 +1,58 @@
+#ifndef OPTIMIZERS_HPP
+#define OPTIMIZERS_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+// For External Library
+#include <torch/torch.h>
+// For Original Header
+#include "arena.hpp"
+
+
+// -----------------------------------
+// namespace{optimizers}
+// -----------------------------------
+namespace optimizers{
+
+    // Constant
+    constexpr int64_t quant_block = 2048;  // the number of elements sharing one scale in 8-bit states
+
+    // Function Prototype
+    std::vector<torch::optim::OptimizerParamGroup> Decay_Groups(std::vector<torch::Tensor> params, const torch::optim::AdamWOptions &options);
+    torch::Tensor Dynamic_Map(const bool is_signed);
+    uint8_t Quantize(const float *map, const float x);
+    torch::Tensor Quantize_Tensor(const torch::Tensor &map, const torch::Tensor &x);
+    size_t State_Bytes(const int64_t numel, const size_t bits);
+
+    // -----------------------------------------
+    // namespace{optimizers} -> class{AdamW}
+    // -----------------------------------------
+    // AdamW whose parameters, gradients and moments live in one flat buffer per group.
+    // Group 0 is decayed (matrices and embeddings), group 1 is not decayed (LayerNorm and biases).
+    // The parameters and gradients are in a ParamArena (shared with the model if given),
+    // so that the update is one vectorized and multithreaded loop per group.
+    // With 'bits_=8', the moments are stored as 8-bit codes of a dynamic map with one absmax scale per block.
+    class AdamW : public torch::optim::Optimizer{
+    private:
+        int64_t step_count;
+        size_t bits;
+        std::shared_ptr<arena::ParamArena> param_arena;
+        std::vector<torch::Tensor> M, V;
+        std::vector<torch::Tensor> M_absmax, V_absmax;
+        torch::Tensor map_signed, map_unsigned;
+        void update(const size_t g);
+        void update_8bit(const size_t g);
+    public:
+        AdamW(std::vector<torch::Tensor> params, torch::optim::AdamWOptions options, const size_t bits_=32, std::shared_ptr<arena::ParamArena> arena_=nullptr);
+        torch::Tensor step(LossClosure closure=nullptr) override;
+        void save(torch::serialize::OutputArchive &archive) const override;
+        void load(torch::serialize::InputArchive &archive) override;
+        size_t state_bytes();
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,98 @@
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+// For Original Header
+#include "perf.hpp"
+#include "memory.hpp"
+
+
+// ---------------------------------------------------------------
+// namespace{perf} -> class{recorder} -> constructor
+// ---------------------------------------------------------------
+// Created at the top of main(), so that the startup time covers loading of the tokenizer, data and model.
+perf::recorder::recorder(){
+    this->origin = std::chrono::steady_clock::now();
+    this->startup_sec = -1.0;
+    this->peak_rss = 0;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{perf} -> class{recorder} -> function{sample_rss}
+// ---------------------------------------------------------------
+// VmHWM is also restarted by memory::Reset_Peak(), so the maximum is kept here.
+void perf::recorder::sample_rss(){
+    this->peak_rss = std::max(this->peak_rss, memory::Process_Usage().hwm);
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{perf} -> class{recorder} -> function{phase}
+// ---------------------------------------------------------------
+void perf::recorder::phase(const std::string name){
+    this->sample_rss();
+    this->phases.push_back(Phase());
+    this->phases.back().name = name;
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{perf} -> class{recorder} -> function{step}
+// ---------------------------------------------------------------
+void perf::recorder::step(const double tokens){
+    if (this->phases.empty()) return;
+    Phase &current = this->phases.back();
+    current.last = std::chrono::steady_clock::now();
+    if (current.steps == 0){
+        current.first = current.last;
+        current.first_tokens = tokens;
+        if (this->startup_sec < 0.0) this->startup_sec = std::chrono::duration<double>(current.first - this->origin).count();
+    }
+    current.steps++;
+    current.tokens += tokens;
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{perf} -> class{recorder} -> function{write}
+// ---------------------------------------------------------------
+// One "key": value per line (read back by scripts/perf_compare.sh).
+void perf::recorder::write(const std::string path){
+
+    constexpr double MB = 1024.0 * 1024.0;
+
+    double sec;
+    std::ofstream ofs(path, std::ios::out);
+
+    this->sample_rss();
+    ofs << "{" << std::endl;
+    ofs << "  \"startup_sec\": " << std::max(this->startup_sec, 0.0) << "," << std::endl;
+    ofs << "  \"peak_rss_mb\": " << (double)this->peak_rss / MB;
+    for (auto &phase : this->phases){
+        sec = std::chrono::duration<double>(phase.last - phase.first).count();
+        ofs << "," << std::endl << "  \"" << phase.name << ".steps\": " << phase.steps;
+        ofs << "," << std::endl << "  \"" << phase.name << ".tokens\": " << phase.tokens;
+        if ((phase.steps > 1) && (sec > 0.0)){
+            ofs << "," << std::endl << "  \"" << phase.name << ".steps_per_s\": " << (double)(phase.steps - 1) / sec;
+            ofs << "," << std::endl << "  \"" << phase.name << ".tokens_per_s\": " << (phase.tokens - phase.first_tokens) / sec;
+        }
+    }
+    ofs << std::endl << "}" << std::endl;
+    ofs.close();
+
+    return;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{perf} -> function{Get_Recorder}
+// ---------------------------------------------------------------
+perf::recorder &perf::Get_Recorder(){
+    static recorder instance;
+    return instance;
+}
@@ -0,0 +1,47 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+
+// -----------------------------------
+// namespace{perf}
+// -----------------------------------
+namespace perf{
+
+    // -----------------------------------
+    // namespace{perf} -> struct{Phase}
+    // -----------------------------------
+    struct Phase{
+        std::string name;
+        size_t steps = 0;
+        double tokens = 0.0, first_tokens = 0.0;
+        std::chrono::steady_clock::time_point first, last;  // ends of the first and the last step
+    };
+
+    // -----------------------------------
+    // namespace{perf} -> class{recorder}
+    // -----------------------------------
+    // End-to-end figures of one run for the regression harness (scripts/perf.sh) : the startup time
+    // until the first step, steady rates of steps and tokens after the first step, and the peak RSS.
+    class recorder{
+    private:
+        std::chrono::steady_clock::time_point origin;
+        double startup_sec;
+        size_t peak_rss;
+        std::vector<Phase> phases;
+        void sample_rss();
+    public:
+        recorder();
+        void phase(const std::string name);
+        void step(const double tokens);
+        void write(const std::string path);
+    };
+
+    recorder &Get_Recorder();
+
+}
+
+#endif
@@ -0,0 +1,294 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <ios>
+#include <iomanip>
+#include <cstdint>
+// For External Library
+#include <torch/torch.h>
+#include <ATen/record_function.h>
+// For Original Header
+#include "profiler.hpp"
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> struct{OpContext}
+// ---------------------------------------------------------------
+namespace profiler{
+    struct OpContext : public at::ObserverContext{
+        int64_t start;
+    };
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> function{On_Enter}
+// ---------------------------------------------------------------
+static std::unique_ptr<at::ObserverContext> On_Enter(const at::RecordFunction &fn){
+    auto ctx = std::make_unique<profiler::OpContext>();
+    ctx->start = profiler::Get_Recorder().now_us();
+    return ctx;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> function{On_Exit}
+// ---------------------------------------------------------------
+static void On_Exit(const at::RecordFunction &fn, at::ObserverContext *ctx_){
+    auto ctx = static_cast<profiler::OpContext*>(ctx_);
+    int64_t end = profiler::Get_Recorder().now_us();
+    profiler::Get_Recorder().add({std::string(fn.name()), fn.threadId(), ctx->start, end - ctx->start, fn.scope() == at::RecordScope::USER_SCOPE});
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> function{Escape}
+// ---------------------------------------------------------------
+static std::string Escape(const std::string &str){
+    std::string out;
+    for (auto &c : str){
+        if ((c == '"') || (c == '\\')) out += '\\';
+        if ((unsigned char)c < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> constructor
+// ---------------------------------------------------------------
+profiler::recorder::recorder(){
+    this->enabled = false;
+    this->active = false;
+    this->sync = false;
+    this->start_step = 0;
+    this->steps = 0;
+    this->count = 0;
+    this->window_start = 0;
+    this->window_end = 0;
+    this->handle = 0;
+    this->origin = std::chrono::steady_clock::now();
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{setup}
+// ---------------------------------------------------------------
+// Profiles the steps [start_step_, start_step_ + steps_), and writes '<path_>.json' and '<path_>.txt'.
+void profiler::recorder::setup(const bool enabled_, const size_t start_step_, const size_t steps_, const std::string path_, const bool sync_){
+    this->close();
+    this->enabled = enabled_ && (steps_ > 0);
+    this->start_step = start_step_;
+    this->steps = steps_;
+    this->path = path_;
+    this->sync = sync_;
+    this->count = 0;
+    if (this->enabled && (this->start_step == 0)) this->begin();
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{step}
+// ---------------------------------------------------------------
+// Called at the end of every step.
+void profiler::recorder::step(){
+    if (!this->enabled) return;
+    this->count++;
+    if (this->count == this->start_step) this->begin();
+    else if (this->count == this->start_step + this->steps) this->finish();
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{close}
+// ---------------------------------------------------------------
+// Writes the results even if the run ended inside the window.
+void profiler::recorder::close(){
+    if (this->active) this->finish();
+    this->enabled = false;
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{begin}
+// ---------------------------------------------------------------
+void profiler::recorder::begin(){
+    if (this->sync && torch::cuda::is_available()) torch::cuda::synchronize();
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->events.clear();
+        this->window_start = this->now_us();
+        this->active = true;
+    }
+    this->handle = at::addGlobalCallback(at::RecordFunctionCallback(On_Enter, On_Exit).needsInputs(false));
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{finish}
+// ---------------------------------------------------------------
+void profiler::recorder::finish(){
+    if (this->sync && torch::cuda::is_available()) torch::cuda::synchronize();
+    at::removeCallback(this->handle);
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->active = false;
+        this->window_end = this->now_us();
+    }
+    this->write_trace();
+    this->write_summary();
+    this->enabled = false;
+    std::cout << "profile : " << this->path << ".json, " << this->path << ".txt" << std::endl;
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{write_trace}
+// ---------------------------------------------------------------
+void profiler::recorder::write_trace(){
+
+    bool first = true;
+    std::ofstream ofs(this->path + ".json", std::ios::out);
+
+    ofs << "{\"traceEvents\":[" << std::endl;
+    for (auto &event : this->events){
+        ofs << (first ? "" : ",\n");
+        ofs << "{\"name\":\"" << Escape(event.name) << "\",\"cat\":\"" << (event.scope ? "scope" : "op") << "\",\"ph\":\"X\"";
+        ofs << ",\"ts\":" << event.start_us - this->window_start << ",\"dur\":" << event.dur_us;
+        ofs << ",\"pid\":0,\"tid\":" << event.tid << "}";
+        first = false;
+    }
+    ofs << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+    ofs.close();
+
+    return;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{write_summary}
+// ---------------------------------------------------------------
+void profiler::recorder::write_summary(){
+
+    constexpr size_t top_ops = 30;  // the number of operators shown
+
+    double window_ms;
+    std::map<std::string, std::pair<size_t, int64_t>> scopes, ops;  // name ==> {calls, total time [us]}
+    std::vector<std::pair<std::string, std::pair<size_t, int64_t>>> sorted;
+    std::ofstream ofs(this->path + ".txt", std::ios::out);
+
+    // (1) Aggregate Events by Name
+    for (auto &event : this->events){
+        auto &entry = event.scope ? scopes[event.name] : ops[event.name];
+        entry.first++;
+        entry.second += event.dur_us;
+    }
+    window_ms = (double)(this->window_end - this->window_start) * 0.001;
+
+    // (2) Write Table
+    auto write_table = [&](const std::string title, std::map<std::string, std::pair<size_t, int64_t>> &table, const size_t limit){
+        sorted = std::vector<std::pair<std::string, std::pair<size_t, int64_t>>>(table.begin(), table.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b){ return a.second.second > b.second.second; });
+        ofs << title << std::endl;
+        ofs << std::left << std::setw(48) << "name" << std::right << std::setw(10) << "calls" << std::setw(14) << "total[ms]" << std::setw(14) << "ms/step" << std::setw(10) << "%" << std::endl;
+        for (size_t i = 0; i < std::min(limit, sorted.size()); i++){
+            double total_ms = (double)sorted.at(i).second.second * 0.001;
+            ofs << std::left << std::setw(48) << sorted.at(i).first.substr(0, 47) << std::right << std::setw(10) << sorted.at(i).second.first;
+            ofs << std::fixed << std::setprecision(3) << std::setw(14) << total_ms << std::setw(14) << total_ms / (double)std::max(this->steps, (size_t)1);
+            ofs << std::setprecision(1) << std::setw(10) << total_ms / window_ms * 100.0 << std::endl;
+            ofs.unsetf(std::ios::fixed);
+        }
+        ofs << std::endl;
+    };
+    ofs << "window : " << this->steps << " steps from step " << this->start_step << " (" << window_ms << " ms)" << std::endl;
+    ofs << "times are inclusive of nested scopes and operators" << (this->sync ? ", and CUDA is synchronized at the scopes" : "") << std::endl << std::endl;
+    write_table("Stages and Layers", scopes, scopes.size());
+    write_table("Top Operators", ops, top_ops);
+    ofs.close();
+
+    return;
+
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{is_active}
+// ---------------------------------------------------------------
+bool profiler::recorder::is_active(){
+    return this->active;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{is_sync}
+// ---------------------------------------------------------------
+bool profiler::recorder::is_sync(){
+    return this->sync;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{now_us}
+// ---------------------------------------------------------------
+int64_t profiler::recorder::now_us(){
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->origin).count();
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{recorder} -> function{add}
+// ---------------------------------------------------------------
+// Called also from threads of autograd.
+void profiler::recorder::add(Event event){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->active) this->events.push_back(std::move(event));
+    return;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> function{Get_Recorder}
+// ---------------------------------------------------------------
+profiler::recorder &profiler::Get_Recorder(){
+    static recorder instance;
+    return instance;
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{scope} -> constructor
+// ---------------------------------------------------------------
+profiler::scope::scope(const char *name_){
+    recorder &rec = Get_Recorder();
+    this->active = rec.is_active();
+    if (!this->active) return;
+    if (rec.is_sync()) torch::cuda::synchronize();
+    this->name = name_;
+    this->start = rec.now_us();
+}
+
+
+// ---------------------------------------------------------------
+// namespace{profiler} -> class{scope} -> destructor
+// ---------------------------------------------------------------
+profiler::scope::~scope(){
+    if (!this->active) return;
+    recorder &rec = Get_Recorder();
+    if (rec.is_sync()) torch::cuda::synchronize();
+    rec.add({std::string(this->name), (uint64_t)at::RecordFunction::currentThreadId(), this->start, rec.now_us() - this->start, true});
+}
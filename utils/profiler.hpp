@@ -0,0 +1,77 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+// For External Library
+#include <torch/torch.h>
+#include <ATen/record_function.h>
+
+
+// -----------------------------------
+// namespace{profiler}
+// -----------------------------------
+namespace profiler{
+
+    // -----------------------------------
+    // namespace{profiler} -> struct{Event}
+    // -----------------------------------
+    struct Event{
+        std::string name;
+        uint64_t tid;
+        int64_t start_us, dur_us;
+        bool scope;  // true: our scopes and modules, false: operators of LibTorch
+    };
+
+    // -----------------------------------
+    // namespace{profiler} -> class{recorder}
+    // -----------------------------------
+    // Records scopes and operators (by the RecordFunction callbacks of LibTorch) over a window of steps,
+    // and writes a Chrome trace (chrome://tracing, Perfetto) and a summary at the end of the window.
+    class recorder{
+    private:
+        bool enabled, active, sync;
+        size_t start_step, steps, count;
+        std::string path;
+        std::chrono::steady_clock::time_point origin;
+        int64_t window_start, window_end;
+        std::vector<Event> events;
+        std::mutex mtx;
+        at::CallbackHandle handle;
+        void begin();
+        void finish();
+        void write_trace();
+        void write_summary();
+    public:
+        recorder();
+        void setup(const bool enabled_, const size_t start_step_, const size_t steps_, const std::string path_, const bool sync_);
+        void step();
+        void close();
+        bool is_active();
+        bool is_sync();
+        int64_t now_us();
+        void add(Event event);
+    };
+
+    recorder &Get_Recorder();
+
+    // -----------------------------------
+    // namespace{profiler} -> class{scope}
+    // -----------------------------------
+    // Wall-clock time of a block in the profiling window (synchronizing CUDA at both ends when the recorder says so).
+    class scope{
+    private:
+        const char *name;
+        int64_t start;
+        bool active;
+    public:
+        scope(const char *name_);
+        ~scope();
+    };
+
+}
+
+#endif
@@ -15,19 +15,33 @@
 #include "progress.hpp"
 
 
+// ---------------------------------------------
+// namespace{progress} -> function{is_terminal}
+// ---------------------------------------------
+bool progress::is_terminal(){
+    static const bool tty = isatty(STDOUT_FILENO);
+    return tty;
+}
+
+
+// ------------------------------------------------
+// namespace{progress} -> function{terminal_width}
+// ------------------------------------------------
+// The width of terminal, or 'fallback_width' when the output is redirected to a file or a pipe.
+size_t progress::terminal_width(){
+    struct winsize ws;
+    if (is_terminal() && (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != -1) && (ws.ws_col > 0)){
+        return ws.ws_col;
+    }
+    return fallback_width;
+}
+
+
 // -------------------------------------------
 // namespace{progress} -> function{separator}
 // -------------------------------------------
 std::string progress::separator(){
-    size_t length;
-    struct winsize ws;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != -1){
-       length = ws.ws_col - 1;
-    }
-    else{
-        std::cerr << "Error : Couldn't get the width of terminal." << std::endl;
-        std::exit(1);
-    }
+    size_t length = terminal_width() - 1;
     return std::string(length, '-');
 }
 
@@ -36,16 +50,8 @@ std::string progress::separator(){
 // namespace{progress} -> function{separator_center}
 // --------------------------------------------------
 std::string progress::separator_center(const std::string word){
-    size_t length;
-    struct winsize ws;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != -1){
-       length = ws.ws_col - 1;
-    }
-    else{
-        std::cerr << "Error : Couldn't get the width of terminal." << std::endl;
-        std::exit(1);
-    }
-    size_t both_width = length - word.length() - 2;
+    size_t length = terminal_width() - 1;
+    size_t both_width = (size_t)std::max((int)0, (int)length - (int)word.length() - 2);
     return std::string(both_width/2, '-') + " " + word + " " + std::string(both_width/2, '-');
 }
 
@@ -71,37 +77,80 @@ std::string progress::current_date(){
 progress::display::display(const size_t count_max_, const std::pair<size_t, size_t> epoch, const std::vector<std::string> loss_){
 
     this->count = 0;
+    this->count_base = 0;
     this->count_max = count_max_;
     this->length = 0;
     this->loss = loss_;
 
     std::stringstream ss;
     ss << "epoch:" << epoch.first << "/" << epoch.second << " ";
-    std::cout << ss.str() << std::flush;
+    if (is_terminal()) std::cout << ss.str() << std::flush;
+    this->header_str = ss.str();
     this->header = ss.str().length();
 
     this->loss_sum = std::vector<float>(this->loss.size(), 0.0);
     this->loss_ave = std::vector<float>(this->loss.size(), 0.0);
-    this->start = std::chrono::system_clock::now();
+    this->init();
 
 }
 
 progress::display::display(const size_t count_max_, const std::string header1, const std::string header2, const std::vector<std::string> loss_){
 
     this->count = 0;
+    this->count_base = 0;
     this->count_max = count_max_;
     this->length = 0;
     this->loss = loss_;
 
     std::stringstream ss;
     ss << header1 << " " << header2 << " ";
-    std::cout << ss.str() << std::flush;
+    if (is_terminal()) std::cout << ss.str() << std::flush;
+    this->header_str = ss.str();
     this->header = ss.str().length();
 
     this->loss_sum = std::vector<float>(this->loss.size(), 0.0);
     this->loss_ave = std::vector<float>(this->loss.size(), 0.0);
-    this->start = std::chrono::system_clock::now();
+    this->init();
+
+}
+
 
+// -------------------------------------------------------------
+// namespace{progress} -> class{display} -> function{init}
+// -------------------------------------------------------------
+void progress::display::init(){
+    this->tty = is_terminal();
+    this->steps = 0;
+    this->step_ema = 0.0;
+    this->samples_ema = 0.0;
+    this->tokens_ema = 0.0;
+    this->start = std::chrono::steady_clock::now();
+    this->last_draw = this->start;
+    this->last_step = this->start;
+    return;
+}
+
+
+// -------------------------------------------------------------
+// namespace{progress} -> class{display} -> function{step}
+// -------------------------------------------------------------
+// Records the data of one step as soon as it is processed (the loss may be given later by increment()).
+void progress::display::step(const size_t samples, const size_t tokens){
+    auto now = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(now - this->last_step).count();
+    if (this->steps == 0){
+        this->step_ema = sec;
+        this->samples_ema = (double)samples;
+        this->tokens_ema = (double)tokens;
+    }
+    else{
+        this->step_ema += ema_alpha * (sec - this->step_ema);
+        this->samples_ema += ema_alpha * ((double)samples - this->samples_ema);
+        this->tokens_ema += ema_alpha * ((double)tokens - this->tokens_ema);
+    }
+    this->steps++;
+    this->last_step = now;
+    return;
 }
 
 
@@ -125,6 +174,15 @@ void progress::display::increment(const std::vector<float> loss_value, std::vect
 
     // (1) Count Up Epochs
     this->count++;
+    for (i = 0; i < this->loss.size(); i++){
+        this->loss_sum.at(i) += loss_value.at(i);
+        this->loss_ave.at(i) = this->loss_sum.at(i) / (float)this->count;
+    }
+
+    // (1.1) Redraw only at Intervals (and at the end)
+    this->end = std::chrono::steady_clock::now();
+    if ((this->count < this->count_max) && (std::chrono::duration<double>(this->end - this->last_draw).count() < (this->tty ? refresh_sec : plain_sec))) return;
+    this->last_draw = this->end;
 
     // (2) Initialization of Terminal Line
     initialize = std::string(this->length, '\b') + std::string(this->length, ' ') + std::string(this->length, '\b');
@@ -138,8 +196,6 @@ void progress::display::increment(const std::vector<float> loss_value, std::vect
     // (4) Get Left String
     left_str = "";
     for (i = 0; i < this->loss.size(); i++){
-        this->loss_sum.at(i) += loss_value.at(i);
-        this->loss_ave.at(i) = this->loss_sum.at(i) / (float)this->count;
         if (flag.at(i)){
             ss.str(""); ss.clear(std::stringstream::goodbit);
             ss << this->loss.at(i) << ":" << loss_value.at(i);
@@ -154,7 +210,6 @@ void progress::display::increment(const std::vector<float> loss_value, std::vect
 
     // (5) Get Times for Right String
     sec_per_iter = 0.0; rem_times = 0;
-    this->end = std::chrono::system_clock::now();
     for (i = 0; i < 6; i++){
         ss.str(""); ss.clear(std::stringstream::goodbit);
         switch (i){
@@ -169,7 +224,7 @@ void progress::display::increment(const std::vector<float> loss_value, std::vect
                 elap_sec_str = ss.str();
                 break;
             case 2:
-                sec_per_iter = (double)std::chrono::duration_cast<std::chrono::milliseconds>(this->end - this->start).count() * 0.001 / (double)this->count;
+                sec_per_iter = (double)std::chrono::duration_cast<std::chrono::milliseconds>(this->end - this->start).count() * 0.001 / (double)(this->count - this->count_base);
                 ss << std::setprecision(3) << sec_per_iter;
                 sec_per_iter_str = ss.str();
                 break;
@@ -195,20 +250,24 @@ void progress::display::increment(const std::vector<float> loss_value, std::vect
     // (6) Get Right String
     ss.str(""); ss.clear(std::stringstream::goodbit);
     ss << "] " << this->count << "/" << this->count_max << " ";
-    ss << "[" << elap_min_str << ":" << elap_sec_str << "<" << rem_min_str << ":" << rem_sec_str << ", " << sec_per_iter_str << "s/it]";
+    ss << "[" << elap_min_str << ":" << elap_sec_str << "<" << rem_min_str << ":" << rem_sec_str << ", " << sec_per_iter_str << "s/it";
+    if ((this->steps > 0) && (this->step_ema > 0.0)){
+        ss << ", " << std::fixed << std::setprecision(1) << this->samples_ema / this->step_ema << " samples/s";
+        ss << ", " << std::setprecision(0) << this->tokens_ema / this->step_ema << " tokens/s";
+        ss << ", " << std::setprecision(3) << this->step_ema << "s/step(ema)";
+    }
+    ss << "]";
     right_str = ss.str();
 
-    // (7) Catch Terminal Size
-    struct winsize ws;
-    ideal_length = 0;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != -1){
-       ideal_length = ws.ws_col - this->header - 1;
-    }
-    else{
-        std::cerr << "Error : Couldn't get the width of terminal." << std::endl;
-        std::exit(1);
+    // (6.1) Output Plain Line (not a terminal)
+    if (!this->tty){
+        std::cout << this->header_str << left_str.substr(0, left_str.length() - 1) << right_str.substr(1) << std::endl;
+        return;
     }
 
+    // (7) Catch Terminal Size
+    ideal_length = (size_t)std::max((int)0, (int)terminal_width() - (int)this->header - 1);
+
     // (8) Get Center String
     center_length = (size_t)std::max((int)1, (int)(ideal_length - left_str.length() - right_str.length()));
     bar_length = (size_t)((float)center_length * (float)this->count / (float)this->count_max);
@@ -225,6 +284,22 @@ void progress::display::increment(const std::vector<float> loss_value, std::vect
 }
 
 
+// -------------------------------------------------------------
+// namespace{progress} -> class{display} -> function{restore}
+// -------------------------------------------------------------
+// Resumes counting from a saved state (the time per iteration is measured after this).
+void progress::display::restore(const size_t count_, const std::vector<float> loss_sum_){
+    this->count = count_;
+    this->count_base = count_;
+    this->loss_sum = loss_sum_;
+    for (size_t i = 0; i < this->loss_sum.size(); i++){
+        this->loss_ave.at(i) = (this->count > 0) ? this->loss_sum.at(i) / (float)this->count : 0.0f;
+    }
+    this->start = std::chrono::steady_clock::now();
+    return;
+}
+
+
 // -------------------------------------------------------------
 // namespace{progress} -> class{display} -> function{get_iters}
 // -------------------------------------------------------------
@@ -233,6 +308,14 @@ size_t progress::display::get_iters(){
 }
 
 
+// -----------------------------------------------------------
+// namespace{progress} -> class{display} -> function{get_sum}
+// -----------------------------------------------------------
+std::vector<float> progress::display::get_sum(){
+    return this->loss_sum;
+}
+
+
 // -----------------------------------------------------------
 // namespace{progress} -> class{display} -> function{get_ave}
 // -----------------------------------------------------------
@@ -249,7 +332,7 @@ float progress::display::get_ave(const int idx){
 // namespace{progress} -> class{display} -> destructor
 // ----------------------------------------------------
 progress::display::~display(){
-    std::cout << std::endl;
+    if (this->tty) std::cout << std::endl;
 }
 
 
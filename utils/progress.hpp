@@ -11,7 +11,14 @@
 // -------------------------
 namespace progress{
 
+    constexpr double refresh_sec = 0.1;  // the minimum interval of redrawing the progress bar on terminal
+    constexpr double plain_sec = 10.0;  // the interval of plain lines when the output is not a terminal
+    constexpr size_t fallback_width = 80;  // the width used when the output is not a terminal
+    constexpr double ema_alpha = 0.1;  // the smoothing factor of throughput
+
     // Function Prototype
+    bool is_terminal();
+    size_t terminal_width();
     std::string separator();
     std::string separator_center(const std::string word);
     std::string current_date();
@@ -21,19 +28,27 @@ namespace progress{
     // ---------------------------------------
     class display{
     private:
-        size_t count;
+        size_t count, count_base;
         size_t count_max;
         size_t header, length;
+        std::string header_str;
+        bool tty;
+        size_t steps;
+        double step_ema, samples_ema, tokens_ema;
         std::vector<std::string> loss;
         std::vector<float> loss_sum;
         std::vector<float> loss_ave;
-        std::chrono::system_clock::time_point start, end;
+        std::chrono::steady_clock::time_point start, end, last_draw, last_step;  // monotonic, so that wall-clock adjustments do not skew the rates and the ETA
+        void init();
     public:
         display(){}
         display(const size_t count_max_, const std::pair<size_t, size_t> epoch, const std::vector<std::string> loss_);
         display(const size_t count_max_, const std::string header1, const std::string header2, const std::vector<std::string> loss_);
+        void step(const size_t samples, const size_t tokens);
         void increment(const std::vector<float> loss_value, std::vector<size_t> hide={});
+        void restore(const size_t count_, const std::vector<float> loss_sum_);
         size_t get_iters();
+        std::vector<float> get_sum();
         std::vector<float> get_ave();
         float get_ave(const int idx);
         ~display();
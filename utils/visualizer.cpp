@@ -5,9 +5,18 @@
 #include <tuple>
 #include <vector>
 #include <utility>
-#include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
 // For External Library
 #include <torch/torch.h>
 // For Original Header
@@ -16,20 +25,153 @@
 // Define Namespace
 namespace fs = std::filesystem;
 
+// Environment Variables for gnuplot
+extern char **environ;
+
+
+// ----------------------------------------------------------
+// namespace{visualizer} -> class{renderer} -> constructor
+// ----------------------------------------------------------
+visualizer::renderer::renderer(const size_t timeout_ms_){
+    this->stopped = false;
+    this->available = true;
+    this->timeout_ms = timeout_ms_;
+    this->thread = std::thread(&visualizer::renderer::run, this);
+}
+
+
+// ----------------------------------------------------------
+// namespace{visualizer} -> class{renderer} -> function{request}
+// ----------------------------------------------------------
+void visualizer::renderer::request(const std::string script){
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        if (!this->available) return;
+        if (std::find(this->pending.begin(), this->pending.end(), script) != this->pending.end()) return;
+        this->pending.push_back(script);
+    }
+    this->cond.notify_all();
+    return;
+}
+
+
+// ----------------------------------------------------------
+// namespace{visualizer} -> class{renderer} -> function{execute}
+// ----------------------------------------------------------
+// Returns false only when gnuplot couldn't be started.
+bool visualizer::renderer::execute(const std::string script){
+
+    int status;
+    pid_t pid, ret;
+    std::string command = "gnuplot";
+    char *argv[] = {command.data(), const_cast<char*>(script.c_str()), nullptr};
+
+    // (1) Start gnuplot
+    if (posix_spawnp(&pid, "gnuplot", nullptr, nullptr, argv, environ) != 0) return false;
+
+    // (2) Wait for Exit within the Time Limit
+    auto start = std::chrono::steady_clock::now();
+    while (true){
+        ret = waitpid(pid, &status, WNOHANG);
+        if ((ret == pid) || ((ret < 0) && (errno != EINTR))) break;
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(this->timeout_ms)){
+            std::cerr << "Warning : gnuplot was killed by timeout (" << script << ")." << std::endl;
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if ((ret == pid) && WIFEXITED(status) && (WEXITSTATUS(status) == 127)) return false;
+
+    return true;
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{visualizer} -> class{renderer} -> function{run}
+// ----------------------------------------------------------
+void visualizer::renderer::run(){
+
+    std::string script;
+
+    while (true){
+
+        // (1) Wait for Request
+        {
+            std::unique_lock<std::mutex> lock(this->mtx);
+            this->cond.wait(lock, [this]{ return this->stopped || !this->pending.empty(); });
+            if (this->pending.empty()) return;
+            script = this->pending.front();
+            this->pending.erase(this->pending.begin());
+        }
+
+        // (2) Render Graph
+        if (!this->execute(script)){
+            std::cerr << "Warning : gnuplot couldn't be started, so that graphs are no longer rendered (the data is still written)." << std::endl;
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->available = false;
+            this->pending.clear();
+        }
+
+    }
+
+}
+
+
+// ----------------------------------------------------------
+// namespace{visualizer} -> class{renderer} -> destructor
+// ----------------------------------------------------------
+visualizer::renderer::~renderer(){
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->stopped = true;
+    }
+    this->cond.notify_all();
+    if (this->thread.joinable()) this->thread.join();
+}
+
+
+// ----------------------------------------------------------
+// namespace{visualizer} -> function{Get_Renderer}
+// ----------------------------------------------------------
+// One renderer shared by all graphs (started at the first use).
+visualizer::renderer &visualizer::Get_Renderer(){
+    static renderer instance;
+    return instance;
+}
+
 
 // ----------------------------------------------------------
 // namespace{visualizer} -> class{graph} -> constructor
 // ----------------------------------------------------------
-visualizer::graph::graph(const std::string dir_, const std::string gname_, const std::vector<std::string> label_){
+visualizer::graph::graph(const std::string dir_, const std::string gname_, const std::vector<std::string> label_, const bool render_){
     this->flag = false;
+    this->render = render_;
     this->dir = dir_;
     this->data_dir = this->dir + "/data";
     this->gname = gname_;
     this->graph_fname= this->dir + '/' + this->gname + ".png";
     this->data_fname= this->data_dir + '/' + this->gname + ".dat";
+    this->script_fname= this->data_dir + '/' + this->gname + ".gp";
     this->label = label_;
     fs::create_directories(this->dir);
     fs::create_directories(this->data_dir);
+    this->data_ofs = std::make_shared<std::ofstream>(this->data_fname, std::ios::app);
+
+    // Script of gnuplot (also used to render on demand)
+    std::ofstream gp(this->script_fname, std::ios::out);
+    gp << "set terminal png" << std::endl;
+    gp << "set output '" << this->graph_fname << "'" << std::endl;
+    gp << "plot ";
+    for (size_t i = 0; i < this->label.size(); i++){
+        gp << "'" << this->data_fname << "' using 1:" << i + 2 << " ti '" << this->label.at(i) << "' with lines";
+        gp << ((i < this->label.size() - 1) ? "," : "");
+    }
+    gp << std::endl;
+    gp.close();
+
 }
 
 
@@ -38,27 +180,16 @@ visualizer::graph::graph(const std::string dir_, const std::string gname_, const
 // ----------------------------------------------------------
 void visualizer::graph::plot(const float base, const std::vector<float> value){
 
-    // (1) Value Output
-    std::ofstream ofs(this->data_fname, std::ios::app);
-    ofs << base << std::flush;
+    // (1) Value Output (the file is kept open, and flushed once for gnuplot)
+    *this->data_ofs << base;
     for (auto &v : value){
-        ofs << ' ' << v << std::flush;
+        *this->data_ofs << ' ' << v;
     }
-    ofs << std::endl;
-    ofs.close();
-
-    // (2) Graph Output
-    if (this->flag){
-        FILE* gp;
-        gp = popen("gnuplot -persist", "w");
-        fprintf(gp, "set terminal png\n");
-        fprintf(gp, "set output '%s'\n", this->graph_fname.c_str());
-        fprintf(gp, "plot ");
-        for (size_t i = 0; i < this->label.size() - 1; i++){
-            fprintf(gp, "'%s' using 1:%zu ti '%s' with lines,", this->data_fname.c_str(), i + 2, this->label.at(i).c_str());
-        }
-        fprintf(gp, "'%s' using 1:%zu ti '%s' with lines\n", this->data_fname.c_str(), this->label.size() + 1, this->label.at(this->label.size() - 1).c_str());
-        pclose(gp);
+    *this->data_ofs << std::endl;
+
+    // (2) Graph Output (in background)
+    if (this->flag && this->render){
+        Get_Renderer().request(this->script_fname);
     }
 
     // (3) Setting for after the Second Time
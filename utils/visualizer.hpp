@@ -5,6 +5,11 @@
 #include <tuple>
 #include <vector>
 #include <utility>
+#include <memory>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 // For External Library
 #include <torch/torch.h>
 
@@ -13,20 +18,46 @@
 // namespace{visualizer}
 // -----------------------------------
 namespace visualizer{
+
+    constexpr size_t render_timeout_ms = 10000;  // gnuplot is killed after this time
+
+    // -----------------------------------
+    // namespace{visualizer} -> class{renderer}
+    // -----------------------------------
+    // Runs gnuplot scripts in a background thread, so that training doesn't wait for rendering.
+    // Requests for a script already waiting are coalesced, because the script reads the latest data when it runs.
+    class renderer{
+    private:
+        bool stopped, available;
+        size_t timeout_ms;
+        std::vector<std::string> pending;
+        std::thread thread;
+        std::mutex mtx;
+        std::condition_variable cond;
+        bool execute(const std::string script);
+        void run();
+    public:
+        renderer(const size_t timeout_ms_=render_timeout_ms);
+        void request(const std::string script);
+        ~renderer();
+    };
+
+    renderer &Get_Renderer();
     
     // -----------------------------------
     // namespace{visualizer} -> class{graph}
     // -----------------------------------
     class graph{
     private:
-        bool flag;
+        bool flag, render;
         std::string dir, data_dir;
         std::string gname;
-        std::string graph_fname, data_fname;
+        std::string graph_fname, data_fname, script_fname;
         std::vector<std::string> label;
+        std::shared_ptr<std::ofstream> data_ofs;
     public:
         graph(){}
-        graph(const std::string dir_, const std::string gname_, const std::vector<std::string> label_);
+        graph(const std::string dir_, const std::string gname_, const std::vector<std::string> label_, const bool render_=true);
         void plot(const float base, const std::vector<float> value);
     };
 